@@ -0,0 +1,510 @@
+// ============================================================
+// bench.cpp
+// Quiz Game Benchmarks
+// Builds the game from quiz.cpp (without its main) and times the
+// question loader, shuffle, difficulty filter, leaderboard, save store,
+// full headless sessions, single answers and the bulk importer on
+// synthetic data of growing size. Each case reports wall time, heap allocations and peak RSS, and
+// all results are written as JSON so runs can be compared for
+// regressions. Answering inside a session must not allocate; the run
+// exits with 1 if it does.
+// Build: g++ -std=c++17 -O2 -pthread bench.cpp -o quiz_bench
+// Run:   ./quiz_bench [sizes=1000,10000,100000,1000000] [dir=bench_out] [out=bench.json]
+// ============================================================
+
+#define QUIZ_NO_MAIN
+#include "quiz.cpp"
+
+#include <new>
+#include <sys/resource.h>
+
+// ---------- ALLOCATION COUNTING ----------
+
+// Every operator new in the process goes through these counters
+atomic<unsigned long long> benchAllocs(0);
+atomic<unsigned long long> benchAllocBytes(0);
+
+void *operator new(size_t n) {
+    benchAllocs.fetch_add(1, memory_order_relaxed);
+    benchAllocBytes.fetch_add(n, memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
+void *operator new[](size_t n) { return operator new(n); }
+
+// Kept out of line so the compiler does not pair inlined frees with news
+__attribute__((noinline)) void benchFreeSimple(void *p) { free(p); }
+
+void operator delete(void *p) noexcept { benchFreeSimple(p); }
+void operator delete[](void *p) noexcept { benchFreeSimple(p); }
+void operator delete(void *p, size_t) noexcept { benchFreeSimple(p); }
+void operator delete[](void *p, size_t) noexcept { benchFreeSimple(p); }
+
+// ---------- RESULTS ----------
+
+struct BenchResult {
+    string name;
+    uint64_t size;                 // data size the case ran on
+    uint64_t ops;                  // operations timed
+    double totalMs;
+    unsigned long long allocs;
+    unsigned long long allocBytes;
+    long peakRssKb;                // process peak RSS after the case
+};
+
+vector<BenchResult> benchResults;
+
+// Set when a case breaks one of its guarantees; main then exits with 1
+bool benchFailed = false;
+
+// Peak resident set size of the process in KB
+long peakRssKbSimple() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// Snapshot taken when a case starts
+struct BenchMark {
+    chrono::steady_clock::time_point t0;
+    unsigned long long allocs;
+    unsigned long long bytes;
+};
+
+BenchMark benchStartSimple() {
+    BenchMark m;
+    m.allocs = benchAllocs.load();
+    m.bytes = benchAllocBytes.load();
+    m.t0 = chrono::steady_clock::now();
+    return m;
+}
+
+// Records a finished case and prints one line for it
+void benchStopSimple(const BenchMark &m, const string &name, uint64_t size, uint64_t ops) {
+    BenchResult r;
+    r.totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - m.t0).count();
+    r.allocs = benchAllocs.load() - m.allocs;
+    r.allocBytes = benchAllocBytes.load() - m.bytes;
+    r.name = name;
+    r.size = size;
+    r.ops = ops;
+    r.peakRssKb = peakRssKbSimple();
+    benchResults.push_back(r);
+    printf("%-16s %9llu %9llu %12.3f ms %12.1f ns/op %12llu allocs %10ld KB\n", name.c_str(),
+           (unsigned long long)size, (unsigned long long)ops, r.totalMs,
+           ops ? r.totalMs * 1e6 / ops : 0.0, r.allocs, r.peakRssKb);
+}
+
+// Escapes a string for a JSON value
+string jsonEscapeSimple(const string &s) {
+    string o;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\') { o += '\\'; o += c; }
+        else if ((unsigned char)c < 0x20) { char b[8]; snprintf(b, sizeof(b), "\\u%04x", c); o += b; }
+        else o += c;
+    }
+    return o;
+}
+
+// Writes all results as JSON
+bool writeBenchJson(const string &path) {
+    ofstream out(path.c_str());
+    if (!out) return false;
+    out << "{\n  \"version\": 1,\n  \"time\": \"" << getTimeStringSimple() << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < benchResults.size(); i++) {
+        const BenchResult &r = benchResults[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"size\": %llu, \"ops\": %llu, \"total_ms\": %.3f, "
+                 "\"ns_per_op\": %.1f, \"allocs\": %llu, \"alloc_bytes\": %llu, \"peak_rss_kb\": %ld}%s\n",
+                 jsonEscapeSimple(r.name).c_str(), (unsigned long long)r.size, (unsigned long long)r.ops,
+                 r.totalMs, r.ops ? r.totalMs * 1e6 / r.ops : 0.0, r.allocs, r.allocBytes, r.peakRssKb,
+                 i + 1 < benchResults.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+// ---------- SYNTHETIC DATA ----------
+
+// Writes a category file of n questions in the Q:/ANSWER:/DIFF: format
+// with difficulties and answers spread evenly
+bool makeSyntheticBank(const string &categoryName, uint64_t n, QuizRng &rng) {
+    ofstream out((categoryName + ".txt").c_str());
+    if (!out) return false;
+    const char diffs[3] = { 'E', 'M', 'H' };
+    for (uint64_t i = 0; i < n; i++) {
+        out << "Q: Synthetic question " << i << " with some extra words to look like a real one?\n";
+        out << "A) Option A" << i << "\nB) Option B" << i << "\nC) Option C" << i << "\nD) Option D" << i << "\n";
+        out << "ANSWER: " << (char)('A' + randBelowSimple(rng, 4)) << "\n";
+        out << "DIFF: " << diffs[randBelowSimple(rng, 3)] << "\n---\n";
+    }
+    return (bool)out;
+}
+
+// Writes n score history lines and n log lines into the active paths
+bool makeSyntheticHistory(uint64_t n, QuizRng &rng) {
+    ofstream hs(quizPaths().highScores.c_str());
+    ofstream lg(quizPaths().logs.c_str());
+    if (!hs || !lg) return false;
+    const char diffs[3] = { 'E', 'M', 'H' };
+    for (uint64_t i = 0; i < n; i++) {
+        int score = (int)randBelowSimple(rng, 80) - 30;
+        const string &cat = defaultCategories[randBelowSimple(rng, DEFAULT_CATEGORY_COUNT)];
+        char d = diffs[randBelowSimple(rng, 3)];
+        hs << "player" << i << "|" << score << "|2024-01-01 00:00:00|" << cat << "|" << d << "\n";
+        lg << "2024-01-01 00:00:00 | player" << i << " | " << cat << " | " << d << " | " << score
+           << " | correct:5 wrong:5\n";
+    }
+    return (bool)hs && (bool)lg;
+}
+
+// ---------- BENCHMARK CASES ----------
+
+// Text parse, first compile to .qbank, then mapped open of one bank.
+// The text parser works in the bank's arena: its allocations are a fixed
+// handful for the file and index vectors, not a few per question.
+const unsigned long long TEXT_FIXED_ALLOCS = 64;
+const double TEXT_ALLOCS_PER_QUESTION = 0.01;
+
+void benchLoaderSimple(const string &cat, uint64_t n) {
+    string qb = cat + ".qbank";
+    remove(qb.c_str());
+    {
+        BenchMark m = benchStartSimple();
+        QuestionBank bank;
+        parseQuestionsText(cat + ".txt", bank);
+        benchStopSimple(m, "load_text", n, 1);
+        unsigned long long allocs = benchResults.back().allocs;
+        uint64_t loaded = bank.count;
+        printf("load_text: %llu questions, %.4f allocs per question\n", (unsigned long long)loaded,
+               loaded ? (double)allocs / loaded : 0.0);
+        if (loaded == 0 || allocs > TEXT_FIXED_ALLOCS + (unsigned long long)(TEXT_ALLOCS_PER_QUESTION * loaded)) {
+            printf("FAIL: %llu heap allocations loading %llu questions from text\n", allocs, (unsigned long long)loaded);
+            benchFailed = true;
+        }
+    }
+    {
+        BenchMark m = benchStartSimple();
+        QuestionBank bank;
+        loadQuestionsFromFile(cat, bank);
+        benchStopSimple(m, "load_compile", n, 1);
+    }
+    {
+        const int reps = 20;
+        BenchMark m = benchStartSimple();
+        for (int i = 0; i < reps; i++) {
+            QuestionBank bank;
+            loadQuestionsFromFile(cat, bank);
+        }
+        benchStopSimple(m, "load_mapped", n, reps);
+    }
+}
+
+// Drawing a session's play order and a full shuffle of the E pool
+void benchShuffleSimple(const string &cat, uint64_t n) {
+    shared_ptr<const QuestionBank> bank = getQuestionBank(cat);
+    DiffIndex idx = bankDiffIndex(*bank, 'E');
+    QuizRng rng = makeRngSimple(42);
+    vector<uint32_t> pick;
+
+    const int reps = 100000;
+    BenchMark m = benchStartSimple();
+    for (int i = 0; i < reps; i++) simpleShuffle(idx.pos, idx.count, (uint32_t)playLength, rng, pick);
+    benchStopSimple(m, "shuffle_session", n, reps);
+
+    const int fullReps = n >= 100000 ? 3 : 30;
+    m = benchStartSimple();
+    for (int i = 0; i < fullReps; i++) simpleShuffle(idx.pos, idx.count, idx.count, rng, pick);
+    benchStopSimple(m, "shuffle_full", n, fullReps);
+}
+
+// Difficulty scans over the bank's diff column: counting the questions of
+// one difficulty, then listing their positions
+void benchFilterSimple(const string &cat, uint64_t n) {
+    shared_ptr<const QuestionBank> bank = getQuestionBank(cat);
+    vector<uint32_t> pos;
+    pos.reserve(bank->count);
+    uint64_t sink = 0;
+
+    const int reps = n >= 100000 ? 100 : 1000;
+    BenchMark m = benchStartSimple();
+    for (int i = 0; i < reps; i++) sink += countByteSimple(bank->diff, bank->count, "EMH"[i % 3]);
+    benchStopSimple(m, "count_diff", n, reps);
+
+    m = benchStartSimple();
+    for (int i = 0; i < reps; i++) {
+        pos.clear();
+        filterByteSimple(bank->diff, bank->count, "EMH"[i % 3], pos);
+        sink += pos.size();
+    }
+    benchStopSimple(m, "filter_diff", n, reps);
+    if (sink == 0 && bank->count > 0) printf("warning: difficulty scans found nothing\n");
+}
+
+// Leaderboard: first view rebuilds the index from n history lines, later
+// views reuse it
+void benchHighScoresSimple(uint64_t n) {
+    streambuf *saved = cout.rdbuf();
+    NullBufSimple nullBuf;
+    cout.rdbuf(&nullBuf);
+
+    BenchMark m = benchStartSimple();
+    showHighScoresSimple();
+    benchStopSimple(m, "highscores_cold", n, 1);
+
+    const int reps = 1000;
+    m = benchStartSimple();
+    for (int i = 0; i < reps; i++) showHighScoresSimple();
+    benchStopSimple(m, "highscores_warm", n, reps);
+
+    cout.rdbuf(saved);
+}
+
+// journalSyncEvery the game ships with; main clears it for the CPU cases
+int benchSyncEvery = 0;
+
+// Save store: n sessions started, each updated once, then all looked up;
+// then updates again with the default journal fsync group
+void benchSaveSimple(uint64_t n) {
+    SaveData sd;
+    sd.categoryName = "science";
+    sd.diff = 'M';
+    sd.seedValue = 1;
+    sd.streamed = false;
+    sd.index = 0;
+    sd.score = 0;
+    sd.correctCount = 0;
+    sd.wrongCount = 0;
+    sd.life = lifeFromBitsSimple(0);
+    sd.streak = 0;
+    sd.replaced = -1;
+    sd.followUp = false;
+    sd.hidden = 0;
+    sd.extraMs = 0;
+    sd.length = playLength;
+
+    BenchMark m = benchStartSimple();
+    for (uint64_t i = 0; i < n; i++) {
+        sd.playerName = "player" + to_string(i);
+        saveGameSimple(sd);
+    }
+    benchStopSimple(m, "save_start", n, n);
+
+    m = benchStartSimple();
+    sd.index = 1;
+    for (uint64_t i = 0; i < n; i++) {
+        sd.playerName = "player" + to_string(i);
+        appendSaveSimple(sd);
+    }
+    benchStopSimple(m, "save_append", n, n);
+
+    m = benchStartSimple();
+    SaveData got;
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        if (loadGameSimple("player" + to_string(i), "science", got)) found++;
+    }
+    benchStopSimple(m, "save_load", n, n);
+    if (found != n) printf("warning: %llu of %llu saves found\n", (unsigned long long)found, (unsigned long long)n);
+
+    // fsyncs reach the disk, so this case stays small
+    uint64_t synced = n < 2000 ? n : 2000;
+    journalSyncEvery = benchSyncEvery;
+    m = benchStartSimple();
+    sd.index = 2;
+    for (uint64_t i = 0; i < synced; i++) {
+        sd.playerName = "player" + to_string(i);
+        appendSaveSimple(sd);
+    }
+    benchStopSimple(m, "save_append_sync", n, synced);
+    journalSyncEvery = 0;
+}
+
+// Full sessions with a random player against one bank
+void benchSessionSimple(const string &cat, uint64_t n) {
+    NullBufSimple nullBuf;
+    ostream out(&nullBuf);
+    AnswerFeed feed = consoleFeedSimple();
+    feed.mode = FEED_RANDOM;
+    feed.rng = makeRngSimple(7);
+    feed.correctPct = 60;
+    feed.lifelinePct = 10;
+
+    const int reps = 1000;
+    BenchMark m = benchStartSimple();
+    for (int i = 0; i < reps; i++) {
+        runSessionSimple("bot" + to_string(i), cat, "EMH"[i % 3], (uint64_t)i, feed, out, NULL);
+    }
+    benchStopSimple(m, "session", n, reps);
+}
+
+// Answers inside a running session must not allocate, including the
+// first answer ever given to a question. A session on a seed no other
+// case uses is played and the heap is counted across every answer except
+// the one that finishes it.
+void benchAnswerSimple(const string &cat, uint64_t n) {
+    NullBufSimple nullBuf;
+    ostream out(&nullBuf);
+    AnswerFeed feed = consoleFeedSimple();
+    feed.mode = FEED_RANDOM;
+    feed.rng = makeRngSimple(11);
+    feed.correctPct = 60;
+    feed.lifelinePct = 30;
+    int savedLength = playLength;
+    playLength = 50;
+
+    QuizSession s;
+    s.timings = NULL;
+    if (!sessionStartSimple(s, "steady", cat, 'E', 0x5EED0A11, out)) { playLength = savedLength; return; }
+    string inp;
+    uint64_t answers = 0;
+    BenchMark m = benchStartSimple();
+    while (s.state != SESSION_DONE) {
+        nextAnswerSimple(feed, s, inp);
+        unsigned long long allocs = benchAllocs.load();
+        unsigned long long bytes = benchAllocBytes.load();
+        sessionInputSimple(s, inp, out);
+        if (s.state == SESSION_DONE) {
+            // finishing writes the score and log; not part of answering
+            m.allocs += benchAllocs.load() - allocs;
+            m.bytes += benchAllocBytes.load() - bytes;
+        } else {
+            answers++;
+        }
+    }
+    benchStopSimple(m, "answer_steady", n, answers);
+    playLength = savedLength;
+    if (benchResults.back().allocs != 0) {
+        printf("FAIL: %llu heap allocations while answering\n", benchResults.back().allocs);
+        benchFailed = true;
+    }
+}
+
+// Bulk import of an n-row CSV into a fresh category, duplicate index
+// included; every row must be written
+void benchImportSimple(const string &dir, uint64_t n, QuizRng &rng) {
+    string csv = dir + "/import.csv";
+    {
+        ofstream out(csv.c_str());
+        out << "question,A,B,C,D,answer,diff\n";
+        const char diffs[3] = { 'E', 'M', 'H' };
+        for (uint64_t i = 0; i < n; i++) {
+            out << "\"Imported question " << i << ", with a comma?\",True,False," << randBelowSimple(rng, 100)
+                << ",None of the above," << (char)('A' + randBelowSimple(rng, 4)) << "," << diffs[randBelowSimple(rng, 3)] << "\n";
+        }
+    }
+    string savedDir = questionDir;
+    questionDir = dir;
+    remove(categoryFileName("imported").c_str());
+    remove(dedupFileName("imported").c_str());
+    remove(bankFileName("imported").c_str());
+
+    ImportConfig cfg;
+    cfg.file = csv;
+    cfg.format = IMPORT_CSV;
+    cfg.category = "imported";
+    cfg.threads = (int)thread::hardware_concurrency();
+    if (cfg.threads < 1) cfg.threads = 1;
+    cfg.dedup = true;
+    cfg.compile = false;
+    ImportReport rep;
+    string fatal;
+    BenchMark m = benchStartSimple();
+    bool ok = importQuestionsSimple(cfg, rep, fatal);
+    benchStopSimple(m, "import", n, n);
+    questionDir = savedDir;
+    if (!ok || rep.imported != n) {
+        printf("FAIL: import wrote %llu of %llu rows %s\n", (unsigned long long)rep.imported, (unsigned long long)n, fatal.c_str());
+        benchFailed = true;
+    }
+}
+
+// Runs every case for one data size in its own directory, with its own
+// save store and leaderboard
+void benchSizeSimple(const string &root, uint64_t n) {
+    string dir = root + "/n" + to_string(n);
+    makeDirSimple(dir);
+    string cat = dir + "/bench";
+    QuizPaths paths;
+    paths.highScores = dir + "/" + defaultPaths.highScores;
+    paths.topScores = dir + "/" + defaultPaths.topScores;
+    paths.logs = dir + "/" + defaultPaths.logs;
+    paths.saveStore = dir + "/" + defaultPaths.saveStore;
+    paths.journal = dir + "/" + defaultPaths.journal;
+    paths.legacySave = dir + "/" + defaultPaths.legacySave;
+    remove(paths.topScores.c_str());
+    remove(paths.saveStore.c_str());
+    remove(paths.journal.c_str());
+    SaveStore store;
+    Leaderboard board;
+    activePaths = &paths;
+    activeStore = &store;
+    activeBoard = &board;
+
+    QuizRng rng = makeRngSimple(n);
+    BenchMark m = benchStartSimple();
+    if (!makeSyntheticBank(cat, n, rng) || !makeSyntheticHistory(n, rng)) {
+        printf("Cannot write synthetic data in %s\n", dir.c_str());
+        return;
+    }
+    benchStopSimple(m, "generate", n, n);
+
+    benchLoaderSimple(cat, n);
+    benchShuffleSimple(cat, n);
+    benchFilterSimple(cat, n);
+    benchHighScoresSimple(n);
+    benchSaveSimple(n < 100000 ? n : 100000);
+    benchSessionSimple(cat, n);
+    benchAnswerSimple(cat, n);
+    benchImportSimple(dir, n, rng);
+
+    closeSaveStore();
+    closeLeaderboard();
+    stopAsyncWriter();
+    activePaths = &defaultPaths;
+    activeStore = &defaultStore;
+    activeBoard = &defaultBoard;
+}
+
+// ---------- MAIN ----------
+
+int main(int argc, char *argv[]) {
+    vector<uint64_t> sizes;
+    sizes.push_back(1000);
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+    string dir = "bench_out";
+    string outPath = "bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 6, "sizes=") == 0) {
+            vector<string> items = splitListSimple(arg.substr(6), ',');
+            sizes.clear();
+            for (size_t k = 0; k < items.size(); k++) sizes.push_back(strtoull(items[k].c_str(), NULL, 10));
+        }
+        else if (arg.compare(0, 4, "dir=") == 0) dir = arg.substr(4);
+        else if (arg.compare(0, 4, "out=") == 0) outPath = arg.substr(4);
+        else { printf("Unknown option: %s\n", arg.c_str()); return 2; }
+    }
+    if (!makeDirSimple(dir)) { printf("Cannot create %s\n", dir.c_str()); return 1; }
+
+    // the session store journal is fsynced in groups; every case but
+    // save_append_sync benchmarks the CPU path
+    benchSyncEvery = journalSyncEvery;
+    journalSyncEvery = 0;
+
+    printf("%-16s %9s %9s %15s %15s %19s %13s\n", "case", "size", "ops", "total", "per op", "allocs", "peak RSS");
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (sizes[i] > 0) benchSizeSimple(dir, sizes[i]);
+    }
+
+    if (!writeBenchJson(outPath)) { printf("Cannot write %s\n", outPath.c_str()); return 1; }
+    printf("Results written to %s\n", outPath.c_str());
+    return benchFailed ? 1 : 0;
+}
@@ -5,44 +5,140 @@
 // It uses arrays, structs, loops, randomization, time tracking
 // and file handling for saving/loading progress, questions,
 // logs, and high scores.
+// Category text files can be compiled into binary banks
+// (<category>.qbank) that are memory-mapped at session start.
+// "quiz --headless" plays scripted or random sessions on several threads
+// and reports throughput and per-phase latency. On Linux, "quiz --serve"
+// hosts many sessions over a local socket (try it with "quiz --client").
+// "quiz --check-scanner" checks the bulk question parser against the
+// line-by-line one on the category files and on fuzzed input, and
+// "quiz --memory" reports what interning question text saves per bank.
+// Adding a question refuses duplicates through a per-category hash index;
+// "quiz --dedup" reports the duplicates already in the banks, and
+// "quiz --import FILE" bulk-loads questions from CSV, TSV or JSON lines.
+// Categories are the question files in the questions directory
+// ("questions=DIR", default "."); "quiz --catalog" lists them, and
+// "prewarm=N" loads every bank up front on N threads. "stats=0" (or
+// QUIZ_STATS=0 in the environment) turns instrumentation off in any mode.
+// The program needs a POSIX system (mmap, flock, poll, dirent); the
+// server additionally needs Linux (epoll).
+// Build: g++ -std=c++17 -O2 -pthread quiz.cpp -o quiz
+// Benchmarks: g++ -std=c++17 -O2 -pthread bench.cpp -o quiz_bench
 // ============================================================
 
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <cctype>
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
 
 using namespace std;
 
 // ---------- CONFIG CONSTANTS ----------
 
-// Maximum number of quiz categories supported
-const int MAX_CATEGORIES = 5;
-
-// Maximum questions that can be loaded from a file
-const int MAX_QUESTIONS = 300;
+// Number of best scores kept per leaderboard in the index
+const int MAX_HIGHS = 200;
 
-// Maximum questions that can be played in a session
-const int MAX_PLAY_QUESTIONS = 100;
+// File names used by the program. They are read through quizPaths(), so
+// a thread can point its sessions at files of its own (see HEADLESS MODE).
+struct QuizPaths {
+    string highScores;    // score history
+    string topScores;     // leaderboard index
+    string logs;          // one line per finished quiz
+    string saveStore;     // suspended sessions
+    string journal;       // per-answer progress journal
+    string legacySave;    // single-save format of older versions
+};
+const QuizPaths defaultPaths = { "high_scores.txt", "high_scores.top", "quiz_logs.txt",
+                                 "saves.db", "saves.jnl", "save_progress.txt" };
+thread_local const QuizPaths *activePaths = &defaultPaths;
 
-// Maximum number of high scores that can be read
-const int MAX_HIGHS = 200;
+// Categories written as samples when the question directory has none
+const int DEFAULT_CATEGORY_COUNT = 5;
+string defaultCategories[DEFAULT_CATEGORY_COUNT] = { "science", "computer", "sports", "history", "iq" };
 
-// File names used by the program
-const string highScoreFile = "high_scores.txt";
-const string logsFile = "quiz_logs.txt";
-const string saveFile = "save_progress.txt";
+// Directory scanned for category files ("." = working directory; any mode
+// takes questions=DIR) and the manifest of question counts kept there
+// (see CATEGORY CATALOG)
+string questionDir = ".";
+string catalogManifestName = "catalog.manifest";
 
-// Available categories
-string categories[MAX_CATEGORIES] = { "science", "computer", "sports", "history", "iq" };
+// Threads that load every bank at startup (0 = each bank loads on first
+// use; any mode takes prewarm=N)
+int prewarmThreads = 0;
 
 // Penalties for wrong answers by difficulty
 int penEasy = 2;
 int penMed  = 3;
 int penHard = 5;
 
+// Questions asked per session (fewer if the pool is smaller); headless and
+// server runs take it from length=N. Each save keeps its own length.
+int playLength = 10;
+
+// Category files at least this big are sampled by streaming (memory stays
+// proportional to playLength) instead of being loaded whole
+uint64_t streamThresholdBytes = 64ULL * 1024 * 1024;
+
+// Record hot-path timers and counters (see INSTRUMENTATION); any mode
+// takes stats=0, as does QUIZ_STATS=0 in the environment
+bool statsEnabled = true;
+
+// Leave journal fsyncs, store checkpoints, leaderboard folding and
+// stats-file writes to a background thread instead of the thread that
+// plays (set by --serve, see QUIZ SERVER)
+bool backgroundPersist = false;
+
+// Stats are rewritten in Prometheus text format to statsFile at most
+// every statsFileEvery seconds (0 = only on exit)
+string statsFile = "quiz_stats.prom";
+int statsFileEvery = 10;
+
+// Per-question outcome counts (see QUESTION STATISTICS); the capacity
+// must be a power of two
+string questionStatsFile = "question_stats.qst";
+uint32_t questionStatsCapacity = 1 << 16;
+
 // Time limits for each difficulty
 int timeEasy = 20;
 int timeMed  = 25;
@@ -50,14 +146,15 @@ int timeHard = 35;
 
 // ---------- STRUCT DEFINITIONS ----------
 
-// Structure to store one quiz question
+// Structure to store one quiz question; the text fields are views into
+// the QuestionBank that loaded it
 struct Question {
     char diff;        // Difficulty level: E, M, H
-    string text;      // Question text
-    string A;         // Option A
-    string B;         // Option B
-    string C;         // Option C
-    string D;         // Option D
+    string_view text; // Question text
+    string_view A;    // Option A
+    string_view B;    // Option B
+    string_view C;    // Option C
+    string_view D;    // Option D
     char correct;     // Correct option: A, B, C, or D
 };
 
@@ -75,11 +172,18 @@ struct SaveData {
     string categoryName;  // Selected category
     char diff;            // Difficulty
     unsigned long seedValue; // Random seed for shuffle
+    bool streamed;        // Questions were sampled by streaming the file
     int index;            // Current question index
     int score;            // Current score
     int correctCount;     // Number of correct answers
     int wrongCount;       // Number of wrong answers
     LifeLines life;       // Lifeline usage state
+    int streak;           // Current run of correct answers
+    int replaced;         // Play position sent to the end by Replace, -1 if none
+    bool followUp;        // Waiting for the answer after 50/50 or extra time
+    int hidden;           // Options 50/50 removed from the current question (bit 0 = A)
+    int extraMs;          // Answer time Extra Time added to the current question
+    int length;           // Questions drawn when the session started
 };
 
 // ---------- UTILITY FUNCTIONS ----------
@@ -101,6 +205,11 @@ string getTimeStringSimple() {
     return string(buf);
 }
 
+// Returns the file names used by the calling thread
+const QuizPaths &quizPaths() {
+    return *activePaths;
+}
+
 // Checks whether a file exists or not
 bool fileExistsSimple(const string &name) {
     ifstream f(name.c_str());
@@ -109,16 +218,36 @@ bool fileExistsSimple(const string &name) {
     return ok;
 }
 
-// Trims whitespace from start and end of a string
-string simpleTrim(const string &s) {
-    int i = 0;
-    int j = (int)s.length() - 1;
+// Trims whitespace from start and end of a string (no copy is made)
+string_view simpleTrim(string_view s) {
+    size_t i = 0;
+    size_t j = s.length();
 
-    while (i <= j && isspace((unsigned char)s[i])) i++;
-    while (j >= i && isspace((unsigned char)s[j])) j--;
+    while (i < j && isspace((unsigned char)s[i])) i++;
+    while (j > i && isspace((unsigned char)s[j - 1])) j--;
+
+    return s.substr(i, j - i);
+}
+
+// Writes all bytes, retrying short writes; returns false on error
+bool writeAllSimple(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
 
-    if (j < i) return "";
-    return s.substr(i, j - i + 1);
+// Returns a temporary name next to path that no other thread or process
+// is using ("<path>.<pid>.<n>.tmp"), for writing a file before renaming it
+// into place
+string tempFileNameSimple(const string &path) {
+    static atomic<unsigned long> nextTemp(0);
+    char buf[48];
+    snprintf(buf, sizeof(buf), ".%ld.%lu.tmp", (long)getpid(), nextTemp.fetch_add(1));
+    return path + buf;
 }
 
 // Converts a character to uppercase
@@ -126,19 +255,227 @@ char upchar(char c) {
     return (char)toupper((unsigned char)c);
 }
 
+// 32-bit FNV-1a hash (save journal record checksums)
+uint32_t fnv1aSimple(const char *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 64-bit FNV-1a hash (save keys and question IDs)
+uint64_t fnv1a64Simple(const char *p, size_t n, uint64_t h = 14695981039346656037ULL) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Fast 32-bit hash of a byte string, eight bytes per step (string
+// interning; never stored, so byte order does not matter)
+uint32_t internHashSimple(const char *p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        p += 8;
+        n -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, n);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 29;
+    return (uint32_t)h;
+}
+
+// Splits "A,B,1" into its items (empty items are kept as empty inputs)
+vector<string> splitListSimple(const string &s, char sep) {
+    vector<string> items;
+    size_t start = 0;
+    while (true) {
+        size_t p = s.find(sep, start);
+        items.push_back(s.substr(start, p == string::npos ? string::npos : p - start));
+        if (p == string::npos) break;
+        start = p + 1;
+    }
+    return items;
+}
+
+// ---------- INSTRUMENTATION ----------
+
+// Scoped timers on the hot paths record into per-thread histograms of
+// power-of-two nanosecond buckets; each thread writes only its own block,
+// so recording takes no lock. A reader (the stats menu or the stats file)
+// sums the blocks of all threads. With statsEnabled off a timer costs one
+// branch and reads no clock.
+enum StatId { STAT_LOAD, STAT_FILTER, STAT_SHUFFLE, STAT_SAVE_START, STAT_SAVE_APPEND,
+              STAT_HIGH_SCORE, STAT_LOG, STAT_INPUT_WAIT, STAT_COUNT };
+const char *statNames[STAT_COUNT] = { "load", "filter", "shuffle", "save_start", "save_append",
+                                      "high_score", "log", "input_wait" };
+
+enum CounterId { COUNT_SESSIONS, COUNT_ANSWERS, COUNT_LIFELINES, COUNT_FINISHED, COUNTER_COUNT };
+const char *counterNames[COUNTER_COUNT] = { "sessions_started", "answers", "lifelines_used", "sessions_finished" };
+
+const int STAT_BUCKETS = 48; // bucket b holds durations in [2^b, 2^(b+1)) ns
+
+// One thread's histograms and counters. Only the owner writes; relaxed
+// atomics let readers see whole values.
+struct ThreadStats {
+    atomic<uint64_t> count[STAT_COUNT];
+    atomic<uint64_t> sumNs[STAT_COUNT];
+    atomic<uint64_t> maxNs[STAT_COUNT];
+    atomic<uint64_t> buckets[STAT_COUNT][STAT_BUCKETS];
+    atomic<uint64_t> counters[COUNTER_COUNT];
+
+    ThreadStats() {
+        for (int s = 0; s < STAT_COUNT; s++) {
+            count[s] = 0;
+            sumNs[s] = 0;
+            maxNs[s] = 0;
+            for (int b = 0; b < STAT_BUCKETS; b++) buckets[s][b] = 0;
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) counters[c] = 0;
+    }
+};
+
+// Blocks of every thread that recorded anything; kept after a thread
+// exits so its numbers still count
+vector<unique_ptr<ThreadStats> > statBlocks;
+mutex statBlocksLock;
+thread_local ThreadStats *myStats = NULL;
+
+// Returns the calling thread's block, registering it on first use
+ThreadStats &threadStatsSimple() {
+    if (myStats == NULL) {
+        lock_guard<mutex> guard(statBlocksLock);
+        statBlocks.push_back(unique_ptr<ThreadStats>(new ThreadStats()));
+        myStats = statBlocks.back().get();
+    }
+    return *myStats;
+}
+
+// Adds one duration to a histogram of the calling thread
+void recordStatSimple(StatId id, uint64_t ns) {
+    ThreadStats &ts = threadStatsSimple();
+    int b = 0;
+    while (b < STAT_BUCKETS - 1 && (ns >> (b + 1)) != 0) b++;
+    ts.count[id].store(ts.count[id].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    ts.sumNs[id].store(ts.sumNs[id].load(memory_order_relaxed) + ns, memory_order_relaxed);
+    if (ns > ts.maxNs[id].load(memory_order_relaxed)) ts.maxNs[id].store(ns, memory_order_relaxed);
+    ts.buckets[id][b].store(ts.buckets[id][b].load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Adds n to a counter of the calling thread
+void countStatSimple(CounterId id, uint64_t n = 1) {
+    if (!statsEnabled) return;
+    ThreadStats &ts = threadStatsSimple();
+    ts.counters[id].store(ts.counters[id].load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Times the enclosing scope into one histogram
+struct ScopedStat {
+    StatId id;
+    bool on;
+    chrono::steady_clock::time_point t0;
+
+    explicit ScopedStat(StatId s) : id(s), on(statsEnabled) {
+        if (on) t0 = chrono::steady_clock::now();
+    }
+    ~ScopedStat() {
+        if (on) recordStatSimple(id, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count());
+    }
+};
+
+// Sum of all threads' blocks
+struct StatsSnapshot {
+    uint64_t count[STAT_COUNT];
+    uint64_t sumNs[STAT_COUNT];
+    uint64_t maxNs[STAT_COUNT];
+    uint64_t buckets[STAT_COUNT][STAT_BUCKETS];
+    uint64_t counters[COUNTER_COUNT];
+};
+
+// Adds up the blocks of all threads
+void snapshotStatsSimple(StatsSnapshot &snap) {
+    memset(&snap, 0, sizeof(snap));
+    lock_guard<mutex> guard(statBlocksLock);
+    for (size_t t = 0; t < statBlocks.size(); t++) {
+        const ThreadStats &ts = *statBlocks[t];
+        for (int s = 0; s < STAT_COUNT; s++) {
+            snap.count[s] += ts.count[s].load(memory_order_relaxed);
+            snap.sumNs[s] += ts.sumNs[s].load(memory_order_relaxed);
+            uint64_t mx = ts.maxNs[s].load(memory_order_relaxed);
+            if (mx > snap.maxNs[s]) snap.maxNs[s] = mx;
+            for (int b = 0; b < STAT_BUCKETS; b++) snap.buckets[s][b] += ts.buckets[s][b].load(memory_order_relaxed);
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) snap.counters[c] += ts.counters[c].load(memory_order_relaxed);
+    }
+}
+
+// Upper bound in ns of the bucket holding fraction p of a histogram
+uint64_t statPercentileNs(const StatsSnapshot &snap, int s, double p) {
+    if (snap.count[s] == 0) return 0;
+    uint64_t want = (uint64_t)(p * snap.count[s] + 0.5);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < STAT_BUCKETS; b++) {
+        seen += snap.buckets[s][b];
+        if (seen >= want) {
+            uint64_t upper = (uint64_t)2 << b;
+            return upper < snap.maxNs[s] ? upper : snap.maxNs[s];
+        }
+    }
+    return snap.maxNs[s];
+}
+
+// Prints the timers and counters as a table
+void printStatsSimple(ostream &out) {
+    StatsSnapshot snap;
+    snapshotStatsSimple(snap);
+    char line[160];
+    snprintf(line, sizeof(line), "%-12s %10s %12s %12s %12s %12s", "timer", "count", "mean us", "p50 us", "p99 us", "max us");
+    out << line << endl;
+    for (int s = 0; s < STAT_COUNT; s++) {
+        double mean = snap.count[s] ? snap.sumNs[s] / 1000.0 / snap.count[s] : 0;
+        snprintf(line, sizeof(line), "%-12s %10llu %12.1f %12.1f %12.1f %12.1f", statNames[s],
+                 (unsigned long long)snap.count[s], mean, statPercentileNs(snap, s, 0.50) / 1000.0,
+                 statPercentileNs(snap, s, 0.99) / 1000.0, snap.maxNs[s] / 1000.0);
+        out << line << endl;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) out << counterNames[c] << ": " << snap.counters[c] << endl;
+    if (!statsEnabled) out << "(recording is off)" << endl;
+}
+
 // ---------- SAMPLE FILE CREATION ----------
 
-// Creates sample category files if they are missing
+// Path of a category's files without extension: names are looked up in
+// questionDir, names that already contain a '/' are used as given
+string categoryStemSimple(const string &categoryName) {
+    if (questionDir.empty() || questionDir == "." || categoryName.find('/') != string::npos) return categoryName;
+    return questionDir + "/" + categoryName;
+}
+
+// Returns the question file name for a category
+string categoryFileName(const string &categoryName) {
+    return categoryStemSimple(categoryName) + ".txt";
+}
+
+// Creates the default sample category files if they are missing
 void makeSampleFilesIfMissing() {
-    for (int i = 0; i < MAX_CATEGORIES; i++) {
-        string fname = categories[i] + ".txt";
+    for (int i = 0; i < DEFAULT_CATEGORY_COUNT; i++) {
+        string fname = categoryFileName(defaultCategories[i]);
 
         if (!fileExistsSimple(fname)) {
             ofstream out(fname.c_str());
             if (!out) continue;
 
             // Sample easy question
-            out << "Q: Sample easy question in " << categories[i] << "?" << endl;
+            out << "Q: Sample easy question in " << defaultCategories[i] << "?" << endl;
             out << "A) Option A" << endl;
             out << "B) Option B" << endl;
             out << "C) Option C" << endl;
@@ -148,7 +485,7 @@ void makeSampleFilesIfMissing() {
             out << "---" << endl;
 
             // Sample medium question
-            out << "Q: Sample medium question in " << categories[i] << "?" << endl;
+            out << "Q: Sample medium question in " << defaultCategories[i] << "?" << endl;
             out << "A) Opt A" << endl;
             out << "B) Opt B" << endl;
             out << "C) Opt C" << endl;
@@ -162,562 +499,4472 @@ void makeSampleFilesIfMissing() {
     }
 }
 
-// ---------- QUESTION LOADING ----------
+// ---------- BINARY QUESTION BANK ----------
 
-// Loads questions from category file into array
-int loadQuestionsFromFile(const string &categoryName, Question qarr[], int maxQ) {
-    string fname = categoryName + ".txt";
+// A compiled bank "<category>.qbank" has six parts:
+//   header  : BankHeader (magic, version, counts, stamp of the source .txt)
+//   columns : count difficulty letters, then count answer letters, padded
+//             to a multiple of 4 bytes
+//   text    : count x BankText (string ids of each question's fields)
+//   strings : stringCount + 1 heap offsets; string i is heap[off[i], off[i+1])
+//   index   : record positions of E, then M, then H questions (uint32 each)
+//   heap    : each distinct question/option text once, not NUL terminated
+// Integers are stored in native byte order; the magic and version fields
+// reject files written by another layout. The .txt file stays the source
+// of truth and the bank is rebuilt whenever its stamp (size, mtime to the
+// nanosecond and inode) changes. Offsets are 32-bit, so a category whose
+// text passes 4 GB is not compiled and is read from its .txt instead.
 
-    // Create sample files if file is missing
-    if (!fileExistsSimple(fname)) {
-        makeSampleFilesIfMissing();
-        if (!fileExistsSimple(fname)) return 0;
-    }
+const char BANK_MAGIC[4] = { 'Q', 'B', 'N', 'K' };
+const uint32_t BANK_VERSION = 1;
 
-    ifstream in(fname.c_str());
-    if (!in.is_open()) return 0;
+struct BankHeader {
+    char magic[4];       // "QBNK"
+    uint32_t version;    // BANK_VERSION
+    uint32_t count;      // number of records
+    uint32_t heapSize;   // bytes in string heap
+    uint64_t srcSize;    // size of source .txt when compiled
+    int64_t srcMtime;    // mtime of source .txt when compiled
+    uint32_t diffCount[3]; // index entries for E, M, H
+    uint32_t stringCount;  // distinct strings in the heap
+    int64_t srcMtimeNs;  // nanosecond part of that mtime
+    uint64_t srcInode;   // inode of that .txt
+};
 
-    string line;
-    Question q;
-    bool reading = false;
-    int count = 0;
+static_assert(sizeof(BankHeader) == 64, "bank header must be 64 bytes");
 
-    // Read file line by line
-    while (getline(in, line) && count < maxQ) {
-        string t = simpleTrim(line);
-        if (t.length() == 0) continue;
+// The text of one question, as ids into the string table. Options such as
+// "True", "None of the above" or a repeated number are stored once however
+// many questions use them.
+struct BankText {
+    uint32_t id[5];      // string ids of text, A, B, C, D
+};
+static_assert(sizeof(BankText) == 5 * sizeof(uint32_t), "text record is the five ids of a question");
 
-        if (t.size() >= 2 && t[0] == 'Q' && t[1] == ':') {
-            reading = true;
-            q.diff = 'E';
-            q.text = simpleTrim(t.substr(2));
-            q.A = q.B = q.C = q.D = "";
-            q.correct = 'A';
-        }
-        else if (reading && t.size() >= 2 && t[0] == 'A' && t[1] == ')') {
-            q.A = simpleTrim(t.substr(2));
-        }
-        else if (reading && t.size() >= 2 && t[0] == 'B' && t[1] == ')') {
-            q.B = simpleTrim(t.substr(2));
-        }
-        else if (reading && t.size() >= 2 && t[0] == 'C' && t[1] == ')') {
-            q.C = simpleTrim(t.substr(2));
-        }
-        else if (reading && t.size() >= 2 && t[0] == 'D' && t[1] == ')') {
-            q.D = simpleTrim(t.substr(2));
-        }
-        else if (reading && t.size() >= 7 && t.substr(0,7) == "ANSWER:") {
-            string v = simpleTrim(t.substr(7));
-            if (v.length() > 0) q.correct = upchar(v[0]);
-        }
-        else if (reading && t.size() >= 5 && t.substr(0,5) == "DIFF:") {
-            string v = simpleTrim(t.substr(5));
-            if (v.length() > 0) q.diff = upchar(v[0]);
-        }
-        else if (t == "---") {
-            if (q.text != "" && q.A != "" && q.B != "" && q.C != "" && q.D != "") {
-                qarr[count] = q;
-                count++;
-            }
-            reading = false;
-        }
-    }
+// A bank file mapped into memory (read in place, never modified)
+struct MappedBank {
+    void *addr;                // start of mapping
+    size_t size;               // mapping length
+    const BankHeader *hdr;     // header at start of file
+    const char *diff;          // difficulty column after header
+    const char *correct;       // answer column after the difficulty column
+    const BankText *text;      // text table after the columns
+    const uint32_t *strings;   // string offsets after the text table
+    const uint32_t *index;     // difficulty index after the string table
+    const char *heap;          // string heap after index
+};
 
-    in.close();
-    return count;
+// Bytes taken by the two one-byte columns of a bank, padding included
+uint64_t bankColumnBytes(uint32_t count) {
+    return ((uint64_t)count * 2 + 3) & ~(uint64_t)3;
 }
 
-// ---------- SHUFFLING ----------
+// Maps a difficulty letter to its index slot (E=0, M=1, H=2), -1 if unknown
+int diffSlot(char d) {
+    if (d == 'E') return 0;
+    if (d == 'M') return 1;
+    if (d == 'H') return 2;
+    return -1;
+}
 
-// Shuffles the questions using Fisher-Yates algorithm
-void simpleShuffle(Question arr[], int n) {
-    for (int i = n - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        Question temp = arr[i];
-        arr[i] = arr[j];
-        arr[j] = temp;
-    }
+// Returns the binary bank file name for a category
+string bankFileName(const string &categoryName) {
+    return categoryStemSimple(categoryName) + ".qbank";
 }
 
-// ---------- HIGH SCORE FUNCTIONS ----------
+// Reads size and mtime of a file; returns false if it does not exist
+bool statFileSimple(const string &name, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
 
-// Saves a high score to file
-void saveHighScore(const string &name, int sc) {
-    ofstream out(highScoreFile.c_str(), ios::app);
-    if (!out) return;
+// Identity of a file on disk; a bank is reused while this stays the same
+struct FileStamp {
+    uint64_t size;       // file size in bytes
+    int64_t mtime;       // modification time (seconds)
+    int64_t mtimeNs;     // nanosecond part of mtime where available
+    uint64_t inode;      // inode number (changes when a file is replaced)
+};
 
-    out << name << "|" << sc << "|" << getTimeStringSimple() << endl;
-    out.close();
+// Reads the stamp of a file; returns false if it does not exist
+bool statStampSimple(const string &name, FileStamp &fs) {
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) return false;
+    fs.size = (uint64_t)st.st_size;
+    fs.mtime = (int64_t)st.st_mtime;
+#ifdef __linux__
+    fs.mtimeNs = (int64_t)st.st_mtim.tv_nsec;
+#else
+    fs.mtimeNs = 0;
+#endif
+    fs.inode = (uint64_t)st.st_ino;
+    return true;
 }
 
-// Displays top 5 high scores
-void showHighScoresSimple() {
-    if (!fileExistsSimple(highScoreFile)) {
-        cout << "No scores yet." << endl;
-        return;
-    }
+// True if two stamps describe the same file contents
+bool sameStampSimple(const FileStamp &a, const FileStamp &b) {
+    return a.size == b.size && a.mtime == b.mtime && a.mtimeNs == b.mtimeNs && a.inode == b.inode;
+}
 
-    ifstream in(highScoreFile.c_str());
-    if (!in.is_open()) {
-        cout << "Cannot open high scores." << endl;
-        return;
-    }
+// Unmaps a bank opened by mapBankFile
+void closeQuestionBank(MappedBank &mb) {
+    if (mb.addr == NULL) return;
+    munmap(mb.addr, mb.size);
+    mb.addr = NULL;
+    mb.size = 0;
+}
 
-    string line;
-    string names[MAX_HIGHS];
-    int scores[MAX_HIGHS];
-    string times[MAX_HIGHS];
-    int count = 0;
+// Maps a bank file and validates its layout; returns false if unusable
+bool mapBankFile(const string &fname, MappedBank &mb) {
+    mb.addr = NULL;
+    mb.size = 0;
 
-    while (getline(in, line) && count < MAX_HIGHS) {
-        int p1 = -1, p2 = -1;
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BankHeader)) { close(fd); return false; }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    mb.addr = p;
+    mb.size = (size_t)st.st_size;
 
-        for (int i = 0; i < (int)line.length(); i++) {
-            if (line[i] == '|' && p1 == -1) { p1 = i; continue; }
-            if (line[i] == '|' && p1 != -1) { p2 = i; break; }
+    const char *base = (const char *)mb.addr;
+    mb.hdr = (const BankHeader *)base;
+    bool ok = memcmp(mb.hdr->magic, BANK_MAGIC, 4) == 0 && mb.hdr->version == BANK_VERSION;
+    uint64_t colBytes = bankColumnBytes(mb.hdr->count);
+    uint64_t textBytes = (uint64_t)mb.hdr->count * sizeof(BankText);
+    uint64_t strBytes = ((uint64_t)mb.hdr->stringCount + 1) * sizeof(uint32_t);
+    uint64_t idxBytes = ((uint64_t)mb.hdr->diffCount[0] + mb.hdr->diffCount[1] + mb.hdr->diffCount[2]) * sizeof(uint32_t);
+    ok = ok && sizeof(BankHeader) + colBytes + textBytes + strBytes + idxBytes + mb.hdr->heapSize == mb.size;
+    if (ok) {
+        const char *p = base + sizeof(BankHeader);
+        mb.diff = p;
+        mb.correct = mb.diff + mb.hdr->count;
+        p += colBytes;
+        mb.text = (const BankText *)p;
+        p += textBytes;
+        mb.strings = (const uint32_t *)p;
+        p += strBytes;
+        mb.index = (const uint32_t *)p;
+        mb.heap = p + idxBytes;
+    }
+    ok = ok && mb.strings[0] == 0 && mb.strings[mb.hdr->stringCount] == mb.hdr->heapSize;
+    for (uint32_t i = 0; ok && i < mb.hdr->stringCount; i++) {
+        if (mb.strings[i] > mb.strings[i + 1]) ok = false;
+    }
+    for (uint32_t i = 0; ok && i < mb.hdr->count; i++) {
+        for (int k = 0; k < 5; k++) {
+            if (mb.text[i].id[k] >= mb.hdr->stringCount) { ok = false; break; }
         }
+    }
+    for (uint64_t i = 0; ok && i < idxBytes / sizeof(uint32_t); i++) {
+        if (mb.index[i] >= mb.hdr->count) ok = false;
+    }
+    if (!ok) closeQuestionBank(mb);
+    return ok;
+}
 
-        if (p1 == -1 || p2 == -1) continue;
+// ---------- QUESTION LOADING ----------
 
-        names[count] = line.substr(0, p1);
-        string scs = line.substr(p1 + 1, p2 - p1 - 1);
-        times[count] = line.substr(p2 + 1);
+// Positions (within a bank) of all questions of one difficulty
+struct DiffIndex {
+    const uint32_t *pos;      // question positions in file order
+    uint32_t count;           // number of positions
+};
 
-        int s = atoi(scs.c_str());
-        scores[count] = s;
-        count++;
-    }
-    in.close();
+// The distinct strings of a bank, each named by a 32-bit id. 'slots' is
+// an open-addressing hash table over 'strings' (hash << 32 | id + 1, 0 for
+// an empty slot) that is only kept while the bank is being built.
+struct StringTable {
+    vector<string_view> strings; // id -> text
+    vector<uint64_t> slots;      // intern lookup while building
+};
 
-    // Sort by score (descending)
-    for (int i = 0; i < count - 1; i++) {
-        int best = i;
-        for (int j = i + 1; j < count; j++) {
-            if (scores[j] > scores[best]) best = j;
-        }
-        if (best != i) {
-            string tn = names[i]; names[i] = names[best]; names[best] = tn;
-            int ts = scores[i]; scores[i] = scores[best]; scores[best] = ts;
-            scores[best] = ts;
-            string tt = times[i]; times[i] = times[best]; times[best] = tt;
-        }
-    }
+// All questions of one category, stored column-wise: the one-byte
+// difficulty and answer of every question sit in two contiguous arrays
+// ('diff' and 'correct'), apart from the text, so scanning by difficulty
+// never pulls question text through the cache. Text is interned: each
+// question keeps five string ids, and each distinct string is a view into
+// either 'arena' (the whole .txt file read in one go) or 'map' (a mapped
+// .qbank), so a bank must stay alive while its questions are in use.
+// byDiff[diffSlot(d)] lists the questions of difficulty d, so a session
+// only ever touches the questions it can play.
+struct QuestionBank {
+    string category;          // Category name
+    uint32_t count;           // Number of questions
+    string arena;             // Raw .txt contents (text mode)
+    string ownDiff;           // Difficulty column storage (text mode)
+    string ownCorrect;        // Answer column storage (text mode)
+    StringTable ownStrings;   // Distinct strings (text mode)
+    vector<uint32_t> ownText; // ids of text, A, B, C, D of each question (text mode)
+    vector<uint32_t> ownIndex[3]; // Difficulty index storage (text mode)
+    MappedBank map;           // Mapped .qbank (binary mode)
+    const char *diff;         // count difficulty letters (ownDiff or map)
+    const char *correct;      // count answer letters (ownCorrect or map)
+    DiffIndex byDiff[3];      // E, M, H positions (into ownIndex or map)
 
-    // print top 5
-    int top = 5;
-    if (count < top) top = count;
-    for (int i = 0; i < top; i++) {
-        cout << (i + 1) << ") " << names[i] << " - " << scores[i] << " (" << times[i] << ")" << endl;
+    QuestionBank() {
+        count = 0;
+        map.addr = NULL;
+        map.size = 0;
+        diff = NULL;
+        correct = NULL;
+        for (int d = 0; d < 3; d++) { byDiff[d].pos = NULL; byDiff[d].count = 0; }
     }
-    if (count == 0) cout << "No scores yet." << endl;
-}
-
-// ---------- LOGGING ----------
+    ~QuestionBank() { closeQuestionBank(map); }
+    QuestionBank(const QuestionBank &) = delete;
+    QuestionBank &operator=(const QuestionBank &) = delete;
+};
 
-// Appends a simple log entry for each quiz run
-void logQuizRun(const string &name, const string &cat, char d, int score, int c, int w) {
-    ofstream out(logsFile.c_str(), ios::app);
-    if (!out) return;
-    out << getTimeStringSimple() << " | " << name << " | " << cat << " | " << d
-        << " | " << score << " | correct:" << c << " wrong:" << w << endl;
-    out.close();
+// Reads a whole file into a string with a single allocation
+bool readWholeFile(const string &fname, string &out) {
+    ifstream in(fname.c_str(), ios::binary);
+    if (!in.is_open()) return false;
+    in.seekg(0, ios::end);
+    streamoff n = in.tellg();
+    if (n < 0) return false;
+    in.seekg(0, ios::beg);
+    out.resize((size_t)n);
+    if (n > 0) in.read(&out[0], n);
+    return (bool)in;
 }
 
-// ---------- SAVE / LOAD GAME ----------
+// Kinds of line in a question file
+enum LineKind { LINE_BLANK, LINE_Q, LINE_A, LINE_B, LINE_C, LINE_D, LINE_ANSWER, LINE_DIFF, LINE_END, LINE_OTHER };
 
-// Writes a minimal save file containing current progress and lifelines
-void saveGameSimple(const SaveData &s) {
-    ofstream out(saveFile.c_str());
-    if (!out) return;
-    out << "PLAYER:" << s.playerName << endl;
-    out << "CAT:" << s.categoryName << endl;
-    out << "DIFF:" << s.diff << endl;
-    out << "SEED:" << s.seedValue << endl;
-    out << "INDEX:" << s.index << endl;
-    out << "SCORE:" << s.score << endl;
-    out << "CORRECT:" << s.correctCount << endl;
-    out << "WRONG:" << s.wrongCount << endl;
-    out << "5050:" << (s.life.used5050 ? "1" : "0") << endl;
-    out << "SKIP:" << (s.life.usedSkip ? "1" : "0") << endl;
-    out << "REP:" << (s.life.usedReplace ? "1" : "0") << endl;
-    out << "EXTRA:" << (s.life.usedExtra ? "1" : "0") << endl;
-    out.close();
+// Classifies one raw line of a question file. 'value' receives the
+// trimmed text after the prefix (question text, option text, or the
+// ANSWER/DIFF value).
+LineKind classifyQuestionLine(string_view line, string_view &value) {
+    string_view t = simpleTrim(line);
+    value = string_view();
+    if (t.length() == 0) return LINE_BLANK;
+
+    if (t.size() >= 2 && t[1] == ':' && t[0] == 'Q') { value = simpleTrim(t.substr(2)); return LINE_Q; }
+    if (t.size() >= 2 && t[1] == ')' && t[0] >= 'A' && t[0] <= 'D') {
+        value = simpleTrim(t.substr(2));
+        return (LineKind)(LINE_A + (t[0] - 'A'));
+    }
+    if (t.size() >= 7 && t.substr(0,7) == "ANSWER:") { value = simpleTrim(t.substr(7)); return LINE_ANSWER; }
+    if (t.size() >= 5 && t.substr(0,5) == "DIFF:") { value = simpleTrim(t.substr(5)); return LINE_DIFF; }
+    if (t == "---") return LINE_END;
+    return LINE_OTHER;
 }
 
-// Loads save file into SaveData structure; returns false if no save
-bool loadGameSimple(SaveData &s) {
-    if (!fileExistsSimple(saveFile)) return false;
-    ifstream in(saveFile.c_str());
-    if (!in.is_open()) return false;
-    string line;
-    while (getline(in, line)) {
-        if (line.size() >= 7 && line.substr(0,7) == "PLAYER:") {
-            s.playerName = line.substr(7);
-        } else if (line.size() >= 4 && line.substr(0,4) == "CAT:") {
-            s.categoryName = line.substr(4);
-        } else if (line.size() >= 5 && line.substr(0,5) == "DIFF:") {
-            string v = line.substr(5);
-            if (v.length() > 0) s.diff = upchar(v[0]);
-        } else if (line.size() >= 5 && line.substr(0,5) == "SEED:") {
-            string v = line.substr(5);
-            s.seedValue = (unsigned long)atol(v.c_str());
-        } else if (line.size() >= 6 && line.substr(0,6) == "INDEX:") {
-            string v = line.substr(6);
-            s.index = atoi(v.c_str());
-        } else if (line.size() >= 6 && line.substr(0,6) == "SCORE:") {
-            string v = line.substr(6);
-            s.score = atoi(v.c_str());
-        } else if (line.size() >= 8 && line.substr(0,8) == "CORRECT:") {
-            string v = line.substr(8);
-            s.correctCount = atoi(v.c_str());
-        } else if (line.size() >= 6 && line.substr(0,6) == "WRONG:") {
-            string v = line.substr(6);
-            s.wrongCount = atoi(v.c_str());
-        } else if (line.size() >= 5 && line.substr(0,5) == "5050:") {
-            string v = line.substr(5);
-            s.life.used5050 = (v == "1");
-        } else if (line.size() >= 5 && line.substr(0,5) == "SKIP:") {
-            string v = line.substr(5);
-            s.life.usedSkip = (v == "1");
-        } else if (line.size() >= 4 && line.substr(0,4) == "REP:") {
-            string v = line.substr(4);
-            s.life.usedReplace = (v == "1");
-        } else if (line.size() >= 6 && line.substr(0,6) == "EXTRA:") {
-            string v = line.substr(6);
-            s.life.usedExtra = (v == "1");
+// Counts the bytes equal to c in p[0..n). With SSE2 this compares 16
+// bytes per step and sums the matches in per-lane byte counters, which
+// are folded every 255 steps before they can overflow.
+uint32_t countByteSimple(const char *p, uint32_t n, char c) {
+    uint32_t total = 0;
+    uint32_t i = 0;
+#ifdef __SSE2__
+    const __m128i key = _mm_set1_epi8(c);
+    const __m128i zero = _mm_setzero_si128();
+    while (n - i >= 16) {
+        uint32_t steps = (n - i) / 16;
+        if (steps > 255) steps = 255;
+        __m128i acc = zero;
+        for (uint32_t k = 0; k < steps; k++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, key));
         }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        total += (uint32_t)_mm_cvtsi128_si32(sums) + (uint32_t)_mm_extract_epi16(sums, 4);
     }
-    in.close();
-    return true;
+#endif
+    for (; i < n; i++) total += p[i] == c;
+    return total;
 }
 
-// Removes the save file (called when quiz completes)
-void clearSaveSimple() {
-    if (fileExistsSimple(saveFile)) remove(saveFile.c_str());
+// Appends the positions of the bytes equal to c in p[0..n) to out, in
+// order. With SSE2 each 16-byte step yields a match mask and only its set
+// bits are visited.
+void filterByteSimple(const char *p, uint32_t n, char c, vector<uint32_t> &out) {
+    uint32_t i = 0;
+#ifdef __SSE2__
+    const __m128i key = _mm_set1_epi8(c);
+    for (; n - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, key));
+        while (mask != 0) {
+            out.push_back(i + (uint32_t)__builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (p[i] == c) out.push_back(i);
+    }
 }
 
-// ---------- PENALTY and TIME HELPERS ----------
+// Empties the text-mode storage of a bank
+void clearBankSimple(QuestionBank &bank) {
+    bank.count = 0;
+    bank.arena.clear();
+    bank.ownDiff.clear();
+    bank.ownCorrect.clear();
+    bank.ownStrings.strings.clear();
+    bank.ownStrings.slots.clear();
+    bank.ownText.clear();
+    bank.diff = NULL;
+    bank.correct = NULL;
+    for (int d = 0; d < 3; d++) { bank.ownIndex[d].clear(); bank.byDiff[d].pos = NULL; bank.byDiff[d].count = 0; }
+}
 
-// Returns penalty based on difficulty character
-int getPenaltySimple(char d) {
-    if (d == 'E') return penEasy;
-    if (d == 'M') return penMed;
-    return penHard;
+// Grows the hash table of t so that 'more' further strings fit without
+// filling it past half
+void reserveStringsSimple(StringTable &t, size_t more) {
+    size_t want = t.slots.empty() ? 1024 : t.slots.size();
+    while ((t.strings.size() + more) * 2 > want) want *= 2;
+    if (want == t.slots.size()) return;
+    vector<uint64_t> old;
+    old.swap(t.slots);
+    t.slots.assign(want, 0);
+    size_t mask = want - 1;
+    for (size_t i = 0; i < old.size(); i++) {
+        if (old[i] == 0) continue;
+        size_t j = (size_t)(old[i] >> 32) & mask;
+        while (t.slots[j] != 0) j = (j + 1) & mask;
+        t.slots[j] = old[i];
+    }
 }
 
-// Returns time limit (seconds) based on difficulty
-int getTimeLimitSimple(char d) {
-    if (d == 'E') return timeEasy;
-    if (d == 'M') return timeMed;
-    return timeHard;
+// Returns the id of s (whose hash is h) in the table, adding it if it is
+// new. The caller has made room with reserveStringsSimple.
+uint32_t internHashedSimple(StringTable &t, string_view s, uint32_t h) {
+    size_t mask = t.slots.size() - 1;
+    for (size_t j = h & mask; ; j = (j + 1) & mask) {
+        uint64_t slot = t.slots[j];
+        if (slot == 0) {
+            uint32_t id = (uint32_t)t.strings.size();
+            t.strings.push_back(s);
+            t.slots[j] = ((uint64_t)h << 32) | (id + 1);
+            return id;
+        }
+        if ((uint32_t)(slot >> 32) == h && t.strings[(uint32_t)slot - 1] == s) return (uint32_t)slot - 1;
+    }
 }
 
-// ---------- ASK SINGLE QUESTION ----------
+// Appends one question to the text-mode columns. The five fields are
+// hashed first and their table slots prefetched together, so on a large
+// bank the cache misses of the five lookups overlap instead of queueing.
+void appendBankQuestion(QuestionBank &bank, const Question &q) {
+    bank.ownDiff.push_back(q.diff);
+    bank.ownCorrect.push_back(q.correct);
+    StringTable &t = bank.ownStrings;
+    reserveStringsSimple(t, 5);
+    string_view f[5] = { q.text, q.A, q.B, q.C, q.D };
+    uint32_t h[5];
+    for (int k = 0; k < 5; k++) {
+        h[k] = internHashSimple(f[k].data(), f[k].size());
+#ifdef __SSE2__
+        _mm_prefetch((const char *)&t.slots[h[k] & (t.slots.size() - 1)], _MM_HINT_T0);
+#endif
+    }
+    for (int k = 0; k < 5; k++) bank.ownText.push_back(internHashedSimple(t, f[k], h[k]));
+}
 
-// Presents one question, handles lifelines and timing, returns a code:
-// 1 => correct, 0 => wrong, -1 => timeout, 2 => skip, 3 => replace, 4 => invalid/no answer
-int askQuestionSimple(Question q, LifeLines &life, int &streak) {
-    cout << "Q: " << q.text << endl;
-    cout << "A) " << q.A << endl;
-    cout << "B) " << q.B << endl;
-    cout << "C) " << q.C << endl;
-    cout << "D) " << q.D << endl;
-
-    // show available lifelines
-    cout << "Lifelines: ";
-    if (!life.used5050) cout << "[1]50/50 ";
-    if (!life.usedSkip) cout << "[2]Skip ";
-    if (!life.usedReplace) cout << "[3]Replace ";
-    if (!life.usedExtra) cout << "[4]ExtraTime ";
-    cout << endl;
-
-    int limit = getTimeLimitSimple(q.diff);
-    time_t start = time(NULL);
-
-    cout << "Enter answer letter (A-D) or lifeline number: ";
-    string inp;
-    if (!getline(cin, inp)) inp = "";
+// Points the bank at its text-mode columns once they are complete, drops
+// the intern lookup and builds the difficulty index by scanning the
+// difficulty column
+void finishBankIndex(QuestionBank &bank) {
+    vector<uint64_t>().swap(bank.ownStrings.slots);
+    bank.count = (uint32_t)bank.ownDiff.size();
+    bank.diff = bank.ownDiff.data();
+    bank.correct = bank.ownCorrect.data();
+    for (int d = 0; d < 3; d++) {
+        char letter = "EMH"[d];
+        bank.ownIndex[d].clear();
+        bank.ownIndex[d].reserve(countByteSimple(bank.diff, bank.count, letter));
+        filterByteSimple(bank.diff, bank.count, letter, bank.ownIndex[d]);
+        bank.byDiff[d].pos = bank.ownIndex[d].data();
+        bank.byDiff[d].count = (uint32_t)bank.ownIndex[d].size();
+    }
+}
 
-    time_t now = time(NULL);
-    int used = (int)difftime(now, start);
-
-    // If lifeline chosen (numeric input)
-    if (inp.length() > 0 && isdigit((unsigned char)inp[0])) {
-        char c = inp[0];
-        if (c == '1' && !life.used5050) {
-    life.used5050 = true;
-    cout << "50/50 used. Showing correct option and one wrong option:" << endl;
-
-    // Print the correct option first
-    char corr = q.correct;
-    if (corr == 'A') cout << "A) " << q.A << endl;
-    else if (corr == 'B') cout << "B) " << q.B << endl;
-    else if (corr == 'C') cout << "C) " << q.C << endl;
-    else if (corr == 'D') cout << "D) " << q.D << endl;
-
-    // Then print the first wrong option that is not the correct one
-    for (char x = 'A'; x <= 'D'; x++) {
-        if (x == corr) continue;
-        if (x == 'A') cout << "A) " << q.A << endl;
-        else if (x == 'B') cout << "B) " << q.B << endl;
-        else if (x == 'C') cout << "C) " << q.C << endl;
-        else if (x == 'D') cout << "D) " << q.D << endl;
-        break;
-    }
-
-    cout << "Enter answer (A-D): ";
-    if (!getline(cin, inp)) inp = "";
-    used = 0;
-}
-
-        else if (c == '2' && !life.usedSkip) {
-            life.usedSkip = true;
-            cout << "Skipped." << endl;
-            return 2;
-        }
-        else if (c == '3' && !life.usedReplace) {
-            life.usedReplace = true;
-            cout << "Replace used. This question will appear later." << endl;
-            return 3;
-        }
-        else if (c == '4' && !life.usedExtra) {
-            life.usedExtra = true;
-            limit += 10; // grant +10 seconds
-            cout << "Extra time granted. Enter answer: ";
-            if (!getline(cin, inp)) inp = "";
-            used = 0;
+// Applies one classified line to the question being read; returns true
+// when a "---" completes a question and it is appended to the bank.
+// Questions missing text or an option are dropped.
+bool feedQuestionLine(QuestionBank &bank, Question &q, bool &reading, LineKind kind, string_view v) {
+    if (kind == LINE_Q) {
+        reading = true;
+        q.diff = 'E';
+        q.text = v;
+        q.A = q.B = q.C = q.D = string_view();
+        q.correct = 'A';
+    }
+    else if (kind == LINE_END) {
+        bool added = false;
+        if (!q.text.empty() && !q.A.empty() && !q.B.empty() && !q.C.empty() && !q.D.empty()) {
+            appendBankQuestion(bank, q);
+            added = true;
         }
+        reading = false;
+        return added;
     }
-
-    // Check timeout after lifeline handling
-    if (used > limit) {
-        cout << "Time up!" << endl;
-        return -1;
+    else if (reading) {
+        if (kind == LINE_A) q.A = v;
+        else if (kind == LINE_B) q.B = v;
+        else if (kind == LINE_C) q.C = v;
+        else if (kind == LINE_D) q.D = v;
+        else if (kind == LINE_ANSWER && v.length() > 0) q.correct = upchar(v[0]);
+        else if (kind == LINE_DIFF && v.length() > 0) q.diff = upchar(v[0]);
     }
+    return false;
+}
 
-    if (inp.length() == 0) {
-        cout << "No answer entered." << endl;
-        return 4;
+// Parses bank.arena one line at a time with classifyQuestionLine. This is
+// the reference the bulk scanner is checked against (quiz --check-scanner).
+int parseQuestionLines(QuestionBank &bank) {
+    string_view all(bank.arena);
+    Question q;
+    q.diff = 'E';
+    q.correct = 'A';
+    bool reading = false;
+    int count = 0;
+
+    size_t pos = 0;
+    while (pos < all.size()) {
+        size_t nl = all.find('\n', pos);
+        if (nl == string_view::npos) nl = all.size();
+        string_view v;
+        LineKind kind = classifyQuestionLine(all.substr(pos, nl - pos), v);
+        pos = nl + 1;
+        if (feedQuestionLine(bank, q, reading, kind, v)) count++;
     }
+    return count;
+}
 
-    char ans = upchar(inp[0]);
-    if (ans == q.correct) {
-        cout << "Correct!" << endl;
-        streak++;
-        return 1;
-    } else if (ans >= 'A' && ans <= 'D') {
-        cout << "Wrong. Correct was " << q.correct << endl;
-        streak = 0;
-        return 0;
-    } else {
-        cout << "Invalid input." << endl;
-        return 4;
+// Returns the first '\n' in [p, end), or end. With SSE2 the search
+// compares 16 bytes per step.
+const char *findNewlineSimple(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i key = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, key));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 16;
     }
+#endif
+    while (p < end && *p != '\n') p++;
+    return p;
 }
 
-// ---------- START A NEW QUIZ SESSION ----------
+// Whitespace as isspace() sees it in the C locale
+inline bool scanSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
 
-// Orchestrates a full quiz play session (loads questions, shuffles,
-// applies lifelines, tracks score, saves progress, and finishes)
-void startQuizSimple(const string &player, const string &cat, char diff) {
-    // load all questions for the category
-    Question pool[MAX_QUESTIONS];
-    int total = loadQuestionsFromFile(cat, pool, MAX_QUESTIONS);
-    if (total == 0) {
-        cout << "No questions found for this category." << endl;
-        return;
-    }
+// Classifies the line [b, e) like classifyQuestionLine, but straight from
+// the buffer: the line is trimmed in place and dispatched on its first
+// two bytes, so no substrings are built and isspace() is never called.
+LineKind scanLineSimple(const char *b, const char *e, string_view &value) {
+    while (b < e && scanSpace(*b)) b++;
+    while (e > b && scanSpace(e[-1])) e--;
+    value = string_view();
+    size_t n = (size_t)(e - b);
+    if (n == 0) return LINE_BLANK;
+    if (n < 2) return LINE_OTHER;
 
-    // filter questions by difficulty
-    Question pick[MAX_PLAY_QUESTIONS];
-    int pickCount = 0;
-    for (int i = 0; i < total; i++) {
-        if (pool[i].diff == diff) {
-            if (pickCount < MAX_PLAY_QUESTIONS) {
-                pick[pickCount] = pool[i];
-                pickCount++;
-            }
-        }
+    LineKind kind;
+    size_t prefix;
+    if (b[1] == ':' && b[0] == 'Q') { kind = LINE_Q; prefix = 2; }
+    else if (b[1] == ')' && b[0] >= 'A' && b[0] <= 'D') { kind = (LineKind)(LINE_A + (b[0] - 'A')); prefix = 2; }
+    else if (b[0] == 'A' && n >= 7 && memcmp(b, "ANSWER:", 7) == 0) { kind = LINE_ANSWER; prefix = 7; }
+    else if (b[0] == 'D' && n >= 5 && memcmp(b, "DIFF:", 5) == 0) { kind = LINE_DIFF; prefix = 5; }
+    else if (n == 3 && b[0] == '-' && b[1] == '-' && b[2] == '-') return LINE_END;
+    else return LINE_OTHER;
+
+    const char *v = b + prefix;
+    while (v < e && scanSpace(*v)) v++;
+    value = string_view(v, (size_t)(e - v));
+    return kind;
+}
+
+// Parses bank.arena in one pass: line ends are found with the vector
+// newline search and each line is classified in place by scanLineSimple.
+// Gives exactly the questions parseQuestionLines gives. A question takes
+// at least six lines, so the columns are reserved once from the line count
+// instead of growing question by question; question text is rarely
+// repeated, so the string table starts with room for one string each.
+int scanQuestionsText(QuestionBank &bank) {
+    const char *p = bank.arena.data();
+    const char *end = p + bank.arena.size();
+    if (bank.arena.size() <= UINT32_MAX) {
+        size_t most = countByteSimple(p, (uint32_t)bank.arena.size(), '\n') / 6 + 1;
+        bank.ownDiff.reserve(bank.ownDiff.size() + most);
+        bank.ownCorrect.reserve(bank.ownCorrect.size() + most);
+        bank.ownText.reserve(bank.ownText.size() + most * 5);
+        reserveStringsSimple(bank.ownStrings, most);
     }
-    if (pickCount == 0) {
-        cout << "No questions with selected difficulty." << endl;
-        return;
+    Question q;
+    q.diff = 'E';
+    q.correct = 'A';
+    bool reading = false;
+    int count = 0;
+
+    while (p < end) {
+        const char *nl = findNewlineSimple(p, end);
+        string_view v;
+        LineKind kind = scanLineSimple(p, nl, v);
+        if (feedQuestionLine(bank, q, reading, kind, v)) count++;
+        p = nl + 1;
     }
+    return count;
+}
 
-    // shuffle the chosen questions and record seed for resume
-    unsigned long seedVal = (unsigned long)time(NULL);
-    srand((unsigned int)seedVal);
-    simpleShuffle(pick, pickCount);
+// Parses a Q:/A)/ANSWER:/DIFF:/--- text file into the bank's columns. The
+// file is read once into bank.arena and every field is a view into it;
+// the rules match the original getline parser (trimmed lines, blank lines
+// ignored, questions missing text or an option are dropped at "---").
+int parseQuestionsText(const string &fname, QuestionBank &bank) {
+    clearBankSimple(bank);
+    if (!readWholeFile(fname, bank.arena)) return 0;
+    int count = scanQuestionsText(bank);
+    finishBankIndex(bank);
+    return count;
+}
 
-    int totalQ = pickCount;
-    if (totalQ > 10) totalQ = 10; // limit to 10 questions per play
+// Compiles <category>.txt into <category>.qbank; returns false on failure
+bool compileQuestionBank(const string &categoryName) {
+    string src = categoryFileName(categoryName);
+    FileStamp stamp;
+    if (!statStampSimple(src, stamp)) return false;
 
-    // initialize lifelines and counters
-    LifeLines life;
-    life.used5050 = false;
-    life.usedSkip = false;
-    life.usedReplace = false;
-    life.usedExtra = false;
+    QuestionBank textBank;
+    parseQuestionsText(src, textBank);
+    uint32_t n = textBank.count;
 
-    int score = 0;
-    int correct = 0;
-    int wrong = 0;
-    int streak = 0;
+    BankHeader h;
+    memcpy(h.magic, BANK_MAGIC, 4);
+    h.version = BANK_VERSION;
+    h.count = n;
+    h.heapSize = 0;
+    h.srcSize = stamp.size;
+    h.srcMtime = stamp.mtime;
+    h.srcMtimeNs = stamp.mtimeNs;
+    h.srcInode = stamp.inode;
+    for (int d = 0; d < 3; d++) h.diffCount[d] = (uint32_t)textBank.ownIndex[d].size();
+    h.stringCount = (uint32_t)textBank.ownStrings.strings.size();
 
-    // prepare and save initial save data (so resume works)
-    SaveData sd;
-    sd.playerName = player;
-    sd.categoryName = cat;
-    sd.diff = diff;
-    sd.seedValue = seedVal;
-    sd.index = 0;
-    sd.score = score;
-    sd.correctCount = correct;
-    sd.wrongCount = wrong;
-    sd.life = life;
-    saveGameSimple(sd);
-
-    // main question loop
-    int i = 0;
-    while (i < totalQ) {
-        cout << endl << "Question " << (i + 1) << " of " << totalQ << endl;
-        int res = askQuestionSimple(pick[i], life, streak);
-        if (res == 1) {
-            score++;
-            correct++;
-            if (streak == 3) { score += 5; cout << "Streak +5!" << endl; }
-            if (streak == 5) { score += 15; cout << "Streak +15!" << endl; }
-            i++;
-        }
-        else if (res == 0 || res == -1) {
-            score -= getPenaltySimple(diff);
-            wrong++;
-            i++;
+    // the columns and string ids are written as parsed; the heap holds
+    // each distinct string once and must fit 32-bit offsets
+    const vector<string_view> &strs = textBank.ownStrings.strings;
+    uint64_t heapBytes = 0;
+    for (size_t i = 0; i < strs.size(); i++) heapBytes += strs[i].size();
+    if (heapBytes > UINT32_MAX) return false;
+    vector<uint32_t> table(strs.size() + 1);
+    string heap;
+    heap.reserve((size_t)heapBytes);
+    for (size_t i = 0; i < strs.size(); i++) {
+        table[i] = (uint32_t)heap.size();
+        heap.append(strs[i].data(), strs[i].size());
+    }
+    table[strs.size()] = (uint32_t)heap.size();
+    h.heapSize = (uint32_t)heap.size();
+    const char pad[4] = { 0, 0, 0, 0 };
+
+    // write to a temporary file and rename so readers never see a partial bank
+    string tmp = tempFileNameSimple(bankFileName(categoryName));
+    ofstream out(tmp.c_str(), ios::binary | ios::trunc);
+    if (!out) return false;
+    out.write((const char *)&h, sizeof(h));
+    out.write(textBank.ownDiff.data(), n);
+    out.write(textBank.ownCorrect.data(), n);
+    out.write(pad, bankColumnBytes(n) - (uint64_t)n * 2);
+    if (n > 0) out.write((const char *)&textBank.ownText[0], (size_t)n * sizeof(BankText));
+    out.write((const char *)&table[0], table.size() * sizeof(uint32_t));
+    for (int d = 0; d < 3; d++) {
+        const vector<uint32_t> &ix = textBank.ownIndex[d];
+        if (!ix.empty()) out.write((const char *)&ix[0], ix.size() * sizeof(uint32_t));
+    }
+    out.write(heap.data(), heap.size());
+    out.close();
+    if (!out) { remove(tmp.c_str()); return false; }
+
+    if (rename(tmp.c_str(), bankFileName(categoryName).c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Opens the compiled bank for a category, recompiling it first if it is
+// missing or was compiled from another version of the source .txt file
+bool openQuestionBank(const string &categoryName, MappedBank &mb) {
+    FileStamp stamp;
+    if (!statStampSimple(categoryFileName(categoryName), stamp)) return false;
+
+    string fname = bankFileName(categoryName);
+    if (mapBankFile(fname, mb)) {
+        FileStamp built = { mb.hdr->srcSize, mb.hdr->srcMtime, mb.hdr->srcMtimeNs, mb.hdr->srcInode };
+        if (sameStampSimple(built, stamp)) return true;
+        closeQuestionBank(mb);
+    }
+
+    if (!compileQuestionBank(categoryName)) return false;
+    return mapBankFile(fname, mb);
+}
+
+// Returns field k (0 = text, 1..4 = A..D) of record i as a view into the heap
+string_view bankFieldSimple(const MappedBank &mb, uint32_t i, int k) {
+    uint32_t id = mb.text[i].id[k];
+    return string_view(mb.heap + mb.strings[id], mb.strings[id + 1] - mb.strings[id]);
+}
+
+// Returns the question at position pos of a bank. In binary mode the
+// text is read straight from the mapping, so only played questions
+// are ever touched.
+Question bankQuestion(const QuestionBank &bank, uint32_t pos) {
+    Question q;
+    q.diff = bank.diff[pos];
+    q.correct = bank.correct[pos];
+    if (bank.map.addr == NULL) {
+        const uint32_t *f = &bank.ownText[(size_t)pos * 5];
+        const vector<string_view> &strs = bank.ownStrings.strings;
+        q.text = strs[f[0]];
+        q.A = strs[f[1]];
+        q.B = strs[f[2]];
+        q.C = strs[f[3]];
+        q.D = strs[f[4]];
+        return q;
+    }
+
+    const MappedBank &mb = bank.map;
+    q.text = bankFieldSimple(mb, pos, 0);
+    q.A = bankFieldSimple(mb, pos, 1);
+    q.B = bankFieldSimple(mb, pos, 2);
+    q.C = bankFieldSimple(mb, pos, 3);
+    q.D = bankFieldSimple(mb, pos, 4);
+    return q;
+}
+
+// Returns the difficulty index of a bank (empty for unknown difficulties)
+DiffIndex bankDiffIndex(const QuestionBank &bank, char d) {
+    ScopedStat timer(STAT_FILTER);
+    int slot = diffSlot(d);
+    if (slot < 0) {
+        DiffIndex none = { NULL, 0 };
+        return none;
+    }
+    return bank.byDiff[slot];
+}
+
+// Loads a category into bank; returns the question count
+int loadQuestionsFromFile(const string &categoryName, QuestionBank &bank) {
+    ScopedStat timer(STAT_LOAD);
+    string fname = categoryFileName(categoryName);
+    bank.category = categoryName;
+    clearBankSimple(bank);
+
+    // Create sample files if file is missing
+    if (!fileExistsSimple(fname)) {
+        makeSampleFilesIfMissing();
+        if (!fileExistsSimple(fname)) return 0;
+    }
+
+    // Preferred path: records and index are read from the mapped bank in place
+    closeQuestionBank(bank.map);
+    if (openQuestionBank(categoryName, bank.map)) {
+        const MappedBank &mb = bank.map;
+        bank.count = mb.hdr->count;
+        bank.diff = mb.diff;
+        bank.correct = mb.correct;
+        const uint32_t *p = mb.index;
+        for (int d = 0; d < 3; d++) {
+            bank.byDiff[d].pos = p;
+            bank.byDiff[d].count = mb.hdr->diffCount[d];
+            p += mb.hdr->diffCount[d];
+        }
+        return (int)bank.count;
+    }
+
+    // Fallback: parse the text file into the bank's arena
+    return parseQuestionsText(fname, bank);
+}
+
+// ---------- QUESTION BANK CACHE ----------
+
+// One cached bank and the stamp of the .txt it was loaded from
+struct CachedBank {
+    FileStamp stamp;
+    shared_ptr<const QuestionBank> bank;
+};
+
+// Counters reported by the bank cache
+struct BankCacheStats {
+    unsigned long hits;      // served from memory after a stat
+    unsigned long misses;    // first load of a category
+    unsigned long reloads;   // category reloaded because its file changed
+};
+
+map<string, CachedBank> bankCache;
+set<string> bankLoading;        // categories a thread is loading right now
+mutex bankCacheLock;
+condition_variable bankLoaded;  // signalled when a load finishes
+BankCacheStats bankCacheCounters = { 0, 0, 0 };
+
+// Returns the bank for a category, shared by every caller in the process.
+// A cached bank costs one stat; it is reloaded when the .txt file's size,
+// mtime or inode changes. Sessions keep their own reference, so a reload
+// never invalidates questions that are still being played. One thread
+// loads a category at a time; others asking for it wait for that load
+// instead of parsing and compiling the same file alongside it.
+shared_ptr<const QuestionBank> getQuestionBank(const string &categoryName) {
+    string fname = categoryFileName(categoryName);
+    FileStamp fs;
+    bool exists = statStampSimple(fname, fs);
+
+    bool cached = false;
+    {
+        unique_lock<mutex> guard(bankCacheLock);
+        while (bankLoading.count(categoryName) != 0) bankLoaded.wait(guard);
+        map<string, CachedBank>::iterator it = bankCache.find(categoryName);
+        if (it != bankCache.end()) {
+            if (exists && sameStampSimple(it->second.stamp, fs)) {
+                bankCacheCounters.hits++;
+                return it->second.bank;
+            }
+            cached = true;
+        }
+        if (cached) bankCacheCounters.reloads++;
+        else bankCacheCounters.misses++;
+        bankLoading.insert(categoryName);
+    }
+
+    // load outside the lock so different categories can load in parallel
+    shared_ptr<QuestionBank> bank = make_shared<QuestionBank>();
+    loadQuestionsFromFile(categoryName, *bank);
+
+    // the loader may have created a sample file; stamp it if so
+    if (!exists) exists = statStampSimple(fname, fs);
+
+    lock_guard<mutex> guard(bankCacheLock);
+    if (exists) {
+        CachedBank &entry = bankCache[categoryName];
+        entry.stamp = fs;
+        entry.bank = bank;
+    } else {
+        bankCache.erase(categoryName);
+    }
+    bankLoading.erase(categoryName);
+    bankLoaded.notify_all();
+    return bank;
+}
+
+// Returns a snapshot of the cache counters
+BankCacheStats getBankCacheStats() {
+    lock_guard<mutex> guard(bankCacheLock);
+    return bankCacheCounters;
+}
+
+// ---------- SHUFFLING ----------
+
+// Seeded random generator used for question order. This is splitmix64
+// (state += 0x9E3779B97F4A7C15, then two xor-shift-multiply rounds), so a
+// seed gives the same sequence with every compiler and C library, and a
+// saved seed replays the same order on any platform.
+struct QuizRng {
+    uint64_t state;
+};
+
+// Creates a generator from a session seed
+QuizRng makeRngSimple(uint64_t seed) {
+    QuizRng r;
+    r.state = seed;
+    return r;
+}
+
+// Returns the next 64-bit value of the generator
+uint64_t nextRandSimple(QuizRng &r) {
+    uint64_t z = (r.state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Returns a uniform value in [0, n) without modulo bias
+uint32_t randBelowSimple(QuizRng &r, uint32_t n) {
+    uint64_t limit = (0x100000000ULL / n) * n;
+    while (true) {
+        uint64_t v = nextRandSimple(r) & 0xFFFFFFFFULL;
+        if (v < limit) return (uint32_t)(v % n);
+    }
+}
+
+// Writes the first k items of a random permutation of items[0..n-1] to
+// out, using a Fisher-Yates shuffle that stops after k steps. The item
+// array is never touched: only displaced slots are remembered in 'moved',
+// so the cost is O(k) however large the pool is.
+void simpleShuffle(const uint32_t items[], uint32_t n, uint32_t k, QuizRng &rng, vector<uint32_t> &out) {
+    ScopedStat timer(STAT_SHUFFLE);
+    if (k > n) k = n;
+    out.clear();
+    out.reserve(k);
+    unordered_map<uint32_t, uint32_t> moved;
+    moved.reserve(k);
+
+    for (uint32_t i = 0; i < k; i++) {
+        uint32_t j = i + randBelowSimple(rng, n - i);
+        unordered_map<uint32_t, uint32_t>::iterator mi = moved.find(i);
+        unordered_map<uint32_t, uint32_t>::iterator mj = moved.find(j);
+        uint32_t vi = (mi != moved.end()) ? mi->second : i;
+        uint32_t vj = (mj != moved.end()) ? mj->second : j;
+        out.push_back(items[vj]);
+        moved[j] = vi; // slot i is never visited again, so only j needs updating
+    }
+}
+
+// ---------- STREAMING SAMPLER ----------
+
+// Mixed into the session seed so sampling and shuffling draw different streams
+const uint64_t SAMPLE_SEED_MIX = 0x5851F42D4C957F2DULL;
+
+// One question held in a reservoir slot (owns its text)
+struct SampledQuestion {
+    char diff;           // Difficulty level: E, M, H
+    char correct;        // Correct option: A, B, C, or D
+    string field[5];     // text, A, B, C, D
+};
+
+// True if a category file is big enough to be sampled by streaming
+bool useStreamSampling(const string &categoryName) {
+    uint64_t size;
+    int64_t mtime;
+    return statFileSimple(categoryFileName(categoryName), size, mtime) && size >= streamThresholdBytes;
+}
+
+// Copies a question into a reservoir slot, reusing the slot's buffers
+void copySampleSimple(SampledQuestion &dst, const SampledQuestion &src) {
+    dst.diff = src.diff;
+    dst.correct = src.correct;
+    for (int f = 0; f < 5; f++) dst.field[f].assign(src.field[f]);
+}
+
+// Streams <category>.txt once and keeps a uniform random sample of up to
+// k questions per difficulty (reservoir sampling, Algorithm R). Memory is
+// O(k) whatever the file size, and the same seed and file always give the
+// same sample, so a resumed session rebuilds the same selection. The
+// sample is packed into 'bank' as a small text-mode bank.
+int sampleQuestionsStream(const string &categoryName, uint32_t k, uint64_t seed, QuestionBank &bank) {
+    bank.category = categoryName;
+    clearBankSimple(bank);
+
+    ifstream in(categoryFileName(categoryName).c_str());
+    if (!in.is_open() || k == 0) return 0;
+
+    QuizRng rng = makeRngSimple(seed ^ SAMPLE_SEED_MIX);
+    vector<SampledQuestion> res[3];
+    uint32_t seen[3] = { 0, 0, 0 };
+    for (int d = 0; d < 3; d++) res[d].resize(k);
+
+    SampledQuestion cur;
+    cur.diff = 'E';
+    cur.correct = 'A';
+    bool reading = false;
+    string line;
+
+    // same line rules as parseQuestionsText, but fields are copied into
+    // 'cur' because the line buffer is reused
+    while (getline(in, line)) {
+        string_view v;
+        LineKind kind = classifyQuestionLine(line, v);
+
+        if (kind == LINE_Q) {
+            reading = true;
+            cur.diff = 'E';
+            cur.correct = 'A';
+            cur.field[0].assign(v.data(), v.size());
+            for (int f = 1; f < 5; f++) cur.field[f].clear();
+        }
+        else if (kind == LINE_END) {
+            bool complete = true;
+            for (int f = 0; f < 5; f++) if (cur.field[f].empty()) complete = false;
+            int slot = diffSlot(cur.diff);
+            if (complete && slot >= 0) {
+                seen[slot]++;
+                if (seen[slot] <= k) {
+                    copySampleSimple(res[slot][seen[slot] - 1], cur);
+                } else {
+                    uint32_t j = randBelowSimple(rng, seen[slot]);
+                    if (j < k) copySampleSimple(res[slot][j], cur);
+                }
+            }
+            reading = false;
+        }
+        else if (reading) {
+            if (kind >= LINE_A && kind <= LINE_D) cur.field[1 + (kind - LINE_A)].assign(v.data(), v.size());
+            else if (kind == LINE_ANSWER && v.length() > 0) cur.correct = upchar(v[0]);
+            else if (kind == LINE_DIFF && v.length() > 0) cur.diff = upchar(v[0]);
+        }
+    }
+
+    // pack the kept questions into the bank arena (sized first so the
+    // views taken below are never invalidated by a reallocation)
+    size_t bytes = 0;
+    for (int d = 0; d < 3; d++) {
+        uint32_t kept = seen[d] < k ? seen[d] : k;
+        for (uint32_t i = 0; i < kept; i++)
+            for (int f = 0; f < 5; f++) bytes += res[d][i].field[f].size();
+    }
+    bank.arena.reserve(bytes);
+    for (int d = 0; d < 3; d++) {
+        uint32_t kept = seen[d] < k ? seen[d] : k;
+        for (uint32_t i = 0; i < kept; i++)
+            for (int f = 0; f < 5; f++) bank.arena += res[d][i].field[f];
+    }
+
+    size_t off = 0;
+    for (int d = 0; d < 3; d++) {
+        uint32_t kept = seen[d] < k ? seen[d] : k;
+        for (uint32_t i = 0; i < kept; i++) {
+            const SampledQuestion &sq = res[d][i];
+            string_view parts[5];
+            for (int f = 0; f < 5; f++) {
+                parts[f] = string_view(bank.arena.data() + off, sq.field[f].size());
+                off += sq.field[f].size();
+            }
+            Question q;
+            q.diff = sq.diff;
+            q.correct = sq.correct;
+            q.text = parts[0];
+            q.A = parts[1];
+            q.B = parts[2];
+            q.C = parts[3];
+            q.D = parts[4];
+            appendBankQuestion(bank, q);
+        }
+    }
+
+    finishBankIndex(bank);
+    return (int)bank.count;
+}
+
+// Returns the bank a session plays from: the shared cached bank, or for
+// streamed sessions a private sample of 'length' questions per difficulty
+// drawn with the session seed
+shared_ptr<const QuestionBank> openSessionBank(const string &categoryName, uint64_t seed, bool streamed, int length) {
+    if (!streamed) return getQuestionBank(categoryName);
+    shared_ptr<QuestionBank> bank = make_shared<QuestionBank>();
+    sampleQuestionsStream(categoryName, (uint32_t)length, seed, *bank);
+    return bank;
+}
+
+// ---------- CATEGORY CATALOG ----------
+
+// The categories on offer are the question files in questionDir: every
+// .txt whose first non-blank line starts with "Q:". Building the catalog
+// lists the directory and stats each file but parses nothing, so startup
+// stays flat however many categories there are; a bank loads on first use
+// through the bank cache, or all of them at once with prewarmCatalogSimple.
+// Question counts per difficulty are kept in a manifest next to the files,
+// keyed by each file's stamp (size, mtime to the nanosecond, inode), so
+// they are known without parsing a file again until it changes:
+//   QCAT 1
+//   <name>|<size>|<mtime>|<mtime ns>|<inode>|<E count>|<M count>|<H count>
+//   END <entries>
+
+struct CatalogEntry {
+    string name;             // category name (file stem)
+    FileStamp stamp;         // stamp of the .txt file
+    bool counted;            // diffCount describes the file with this stamp
+    uint32_t diffCount[3];   // E, M, H questions
+};
+
+// Sorted by name. Names are fixed once loadCatalogSimple returns, so they
+// are read without a lock; catalogLock guards the counts.
+vector<CatalogEntry> catalog;
+mutex catalogLock;
+bool catalogDirty = false;   // counts changed since the manifest was read
+
+// Path of the manifest
+string catalogManifestPath() {
+    return (questionDir.empty() ? string(".") : questionDir) + "/" + catalogManifestName;
+}
+
+// True if a file looks like a question file (first non-blank line is "Q:")
+bool isQuestionFileSimple(const string &fname) {
+    char buf[256];
+    FILE *f = fopen(fname.c_str(), "rb");
+    if (f == NULL) return false;
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    size_t i = 0;
+    while (i < n && isspace((unsigned char)buf[i])) i++;
+    return i + 1 < n && buf[i] == 'Q' && buf[i + 1] == ':';
+}
+
+// Reads the manifest into 'known' by name; a torn or foreign file gives
+// nothing
+void readCatalogManifest(map<string, CatalogEntry> &known) {
+    ifstream in(catalogManifestPath().c_str());
+    string line;
+    if (!getline(in, line) || line != "QCAT 1") return;
+    map<string, CatalogEntry> got;
+    while (getline(in, line)) {
+        if (line.compare(0, 4, "END ") == 0) {
+            if (strtoul(line.c_str() + 4, NULL, 10) == got.size()) known.swap(got);
+            return;
+        }
+        vector<string> f = splitListSimple(line, '|');
+        if (f.size() != 8) return;
+        CatalogEntry e;
+        e.name = f[0];
+        e.stamp.size = strtoull(f[1].c_str(), NULL, 10);
+        e.stamp.mtime = strtoll(f[2].c_str(), NULL, 10);
+        e.stamp.mtimeNs = strtoll(f[3].c_str(), NULL, 10);
+        e.stamp.inode = strtoull(f[4].c_str(), NULL, 10);
+        e.counted = true;
+        for (int d = 0; d < 3; d++) e.diffCount[d] = (uint32_t)strtoul(f[5 + d].c_str(), NULL, 10);
+        got[e.name] = e;
+    }
+}
+
+// Writes the counted entries to the manifest (temp file + rename)
+bool writeCatalogManifest() {
+    string path = catalogManifestPath();
+    string tmp = tempFileNameSimple(path);
+    ofstream out(tmp.c_str(), ios::trunc);
+    if (!out) return false;
+    out << "QCAT 1\n";
+    size_t n = 0;
+    {
+        lock_guard<mutex> guard(catalogLock);
+        for (size_t i = 0; i < catalog.size(); i++) {
+            const CatalogEntry &e = catalog[i];
+            if (!e.counted) continue;
+            out << e.name << '|' << e.stamp.size << '|' << e.stamp.mtime << '|'
+                << e.stamp.mtimeNs << '|' << e.stamp.inode << '|'
+                << e.diffCount[0] << '|' << e.diffCount[1] << '|' << e.diffCount[2] << '\n';
+            n++;
+        }
+        catalogDirty = false;
+    }
+    out << "END " << n << '\n';
+    out.close();
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Lists the names of the .txt files in questionDir
+void scanQuestionDir(vector<string> &names) {
+    DIR *dir = opendir(questionDir.empty() ? "." : questionDir.c_str());
+    if (dir == NULL) return;
+    while (dirent *de = readdir(dir)) {
+        string f = de->d_name;
+        if (f.size() > 4 && f.compare(f.size() - 4, 4, ".txt") == 0) names.push_back(f.substr(0, f.size() - 4));
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+}
+
+// Builds the catalog from questionDir, writing the sample categories first
+// when it holds none. Counts are taken from the manifest for files whose
+// stamp is unchanged; only files the manifest does not know are
+// opened, to check that they hold questions. Returns the category count.
+size_t loadCatalogSimple() {
+    map<string, CatalogEntry> known;
+    readCatalogManifest(known);
+
+    vector<CatalogEntry> found;
+    for (int pass = 0; pass < 2 && found.empty(); pass++) {
+        if (pass == 1) makeSampleFilesIfMissing();
+        vector<string> names;
+        scanQuestionDir(names);
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i].find('|') != string::npos) continue;
+            string fname = categoryFileName(names[i]);
+            FileStamp fs;
+            if (!statStampSimple(fname, fs)) continue;
+            map<string, CatalogEntry>::const_iterator it = known.find(names[i]);
+            if (it != known.end() && sameStampSimple(it->second.stamp, fs)) {
+                found.push_back(it->second);
+                continue;
+            }
+            if (!isQuestionFileSimple(fname)) continue;
+            CatalogEntry e;
+            e.name = names[i];
+            e.stamp = fs;
+            e.counted = false;
+            for (int d = 0; d < 3; d++) e.diffCount[d] = 0;
+            found.push_back(e);
+        }
+    }
+
+    lock_guard<mutex> guard(catalogLock);
+    catalog.swap(found);
+    return catalog.size();
+}
+
+// Names of all categories in catalog order
+vector<string> catalogNamesSimple() {
+    vector<string> names;
+    names.reserve(catalog.size());
+    for (size_t i = 0; i < catalog.size(); i++) names.push_back(catalog[i].name);
+    return names;
+}
+
+// Copies the counts of every cached bank into its catalog entry, with the
+// stamp of the file the bank was loaded from
+void syncCatalogCounts() {
+    lock_guard<mutex> cacheGuard(bankCacheLock);
+    lock_guard<mutex> guard(catalogLock);
+    for (size_t i = 0; i < catalog.size(); i++) {
+        CatalogEntry &e = catalog[i];
+        map<string, CachedBank>::const_iterator it = bankCache.find(e.name);
+        if (it == bankCache.end()) continue;
+        const QuestionBank &bank = *it->second.bank;
+        bool same = e.counted && sameStampSimple(e.stamp, it->second.stamp);
+        for (int d = 0; d < 3; d++) same = same && e.diffCount[d] == bank.byDiff[d].count;
+        if (same) continue;
+        e.stamp = it->second.stamp;
+        e.counted = true;
+        for (int d = 0; d < 3; d++) e.diffCount[d] = bank.byDiff[d].count;
+        catalogDirty = true;
+    }
+}
+
+// Records the counts learned since startup in the manifest, if any
+void saveCatalogSimple() {
+    syncCatalogCounts();
+    bool dirty;
+    {
+        lock_guard<mutex> guard(catalogLock);
+        dirty = catalogDirty;
+    }
+    if (dirty) writeCatalogManifest();
+}
+
+// Prewarm worker: loads catalog banks until none are left. Categories
+// big enough to be streamed are skipped, as their sessions never use the
+// cached bank.
+void prewarmWorkerSimple(atomic<size_t> &next) {
+    for (size_t i = next++; i < catalog.size(); i = next++) {
+        if (!useStreamSampling(catalog[i].name)) getQuestionBank(catalog[i].name);
+    }
+}
+
+// Loads every bank of the catalog on a pool of threads and records their
+// counts; returns the wall time in ms
+double prewarmCatalogSimple(int threads) {
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    if (threads > (int)catalog.size()) threads = (int)catalog.size();
+    atomic<size_t> next(0);
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) pool.push_back(thread(prewarmWorkerSimple, ref(next)));
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    syncCatalogCounts();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+// Prints one line per category with its question counts ("?" until the
+// bank has been loaded once)
+void printCatalogSimple(ostream &out) {
+    lock_guard<mutex> guard(catalogLock);
+    char line[160];
+    snprintf(line, sizeof(line), "%-32s %8s %8s %8s", "category", "easy", "medium", "hard");
+    out << line << endl;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        const CatalogEntry &e = catalog[i];
+        if (e.counted) {
+            snprintf(line, sizeof(line), "%-32s %8u %8u %8u", e.name.c_str(), e.diffCount[0], e.diffCount[1], e.diffCount[2]);
+        } else {
+            snprintf(line, sizeof(line), "%-32s %8s %8s %8s", e.name.c_str(), "?", "?", "?");
+        }
+        out << line << endl;
+    }
+    out << catalog.size() << " categories in " << (questionDir.empty() ? string(".") : questionDir) << endl;
+}
+
+// ---------- BANK MEMORY REPORT ----------
+
+// Memory a bank's text takes with interning, next to what it would take
+// with every field stored for itself (bytes)
+struct BankMemory {
+    uint32_t fields;          // question and option fields (5 per question)
+    uint32_t strings;         // distinct strings among them
+    uint64_t textBytes;       // text held
+    uint64_t plainTextBytes;  // text if every field kept its own copy
+    uint64_t tableBytes;      // per-question ids plus the string table
+    uint64_t plainTableBytes; // per-field offset/length records instead
+};
+
+// Measures a bank. A mapped bank holds each distinct string once in its
+// heap, with a 4-byte id per field and a 4-byte offset per string; without
+// interning it held every field, with 8 bytes of offset and length each.
+// A text-mode bank keeps the whole file in its arena either way, so there
+// only the tables shrink: 4-byte ids and one view per distinct string
+// instead of a view per field.
+BankMemory bankMemorySimple(const QuestionBank &bank) {
+    BankMemory m;
+    m.fields = bank.count * 5;
+    if (bank.map.addr != NULL) {
+        const MappedBank &mb = bank.map;
+        m.strings = mb.hdr->stringCount;
+        m.textBytes = mb.hdr->heapSize;
+        m.plainTextBytes = 0;
+        for (uint32_t i = 0; i < bank.count; i++)
+            for (int k = 0; k < 5; k++) m.plainTextBytes += bankFieldSimple(mb, i, k).size();
+        m.tableBytes = (uint64_t)bank.count * sizeof(BankText) + ((uint64_t)m.strings + 1) * sizeof(uint32_t);
+        m.plainTableBytes = (uint64_t)m.fields * 2 * sizeof(uint32_t);
+    } else {
+        m.strings = (uint32_t)bank.ownStrings.strings.size();
+        m.textBytes = bank.arena.size();
+        m.plainTextBytes = bank.arena.size();
+        m.tableBytes = (uint64_t)bank.ownText.size() * sizeof(uint32_t) + (uint64_t)m.strings * sizeof(string_view);
+        m.plainTableBytes = (uint64_t)m.fields * sizeof(string_view);
+    }
+    return m;
+}
+
+// Formats a byte count as B, KB or MB
+string formatBytesSimple(uint64_t n) {
+    char buf[32];
+    if (n < 10 * 1024) snprintf(buf, sizeof(buf), "%llu B", (unsigned long long)n);
+    else if (n < 10 * 1024 * 1024) snprintf(buf, sizeof(buf), "%.1f KB", n / 1024.0);
+    else snprintf(buf, sizeof(buf), "%.1f MB", n / (1024.0 * 1024.0));
+    return buf;
+}
+
+// Formats 'without - with' as a byte count, negative when interning cost
+// more than it saved (a bank with no repeated strings), and as a percentage
+void formatSavedSimple(uint64_t with, uint64_t without, string &bytes, double &pct) {
+    bytes = with > without ? "-" + formatBytesSimple(with - without) : formatBytesSimple(without - with);
+    pct = without ? 100.0 * ((double)without - (double)with) / (double)without : 0.0;
+}
+
+// "quiz --memory [category...]": loads the banks (all catalog categories
+// by default) and prints what interning saves in each
+int runMemoryReportSimple(int argc, char *argv[], int first) {
+    vector<string> names;
+    for (int i = first; i < argc; i++) names.push_back(argv[i]);
+    if (names.empty()) names = catalogNamesSimple();
+
+    char line[200];
+    snprintf(line, sizeof(line), "%-20s %-6s %9s %9s %11s %11s %11s %6s",
+             "category", "mode", "fields", "strings", "with", "without", "saved", "");
+    cout << line << endl;
+    uint64_t totalWith = 0, totalWithout = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!fileExistsSimple(categoryFileName(names[i]))) { cout << "No such category: " << names[i] << endl; continue; }
+        shared_ptr<const QuestionBank> bank = getQuestionBank(names[i]);
+        BankMemory m = bankMemorySimple(*bank);
+        uint64_t with = m.textBytes + m.tableBytes;
+        uint64_t without = m.plainTextBytes + m.plainTableBytes;
+        totalWith += with;
+        totalWithout += without;
+        string saved;
+        double pct;
+        formatSavedSimple(with, without, saved, pct);
+        snprintf(line, sizeof(line), "%-20s %-6s %9u %9u %11s %11s %11s %5.1f%%",
+                 names[i].c_str(), bank->map.addr != NULL ? "mapped" : "text", m.fields, m.strings,
+                 formatBytesSimple(with).c_str(), formatBytesSimple(without).c_str(), saved.c_str(), pct);
+        cout << line << endl;
+    }
+    string saved;
+    double pct;
+    formatSavedSimple(totalWith, totalWithout, saved, pct);
+    snprintf(line, sizeof(line), "%-20s %-6s %9s %9s %11s %11s %11s %5.1f%%", "total", "", "", "",
+             formatBytesSimple(totalWith).c_str(), formatBytesSimple(totalWithout).c_str(), saved.c_str(), pct);
+    cout << line << endl;
+    saveCatalogSimple();
+    return 0;
+}
+
+// ---------- DUPLICATE INDEX ----------
+
+// Two questions are duplicates when their text and their set of options
+// match after normalization: letters are lowercased, anything that is not
+// a letter or digit separates words, and the order of the options does
+// not matter, so "What is 2+2?" with B) 4 and "what is 2 + 2" with A) 4
+// collide. Each category keeps the content hashes of its questions
+// in "<category>.qdup", a memory-mapped open-addressing table stamped with
+// the FileStamp of the .txt it describes:
+//   header : DedupHeader
+//   slots  : capacity x uint64 content hash (0 = empty)
+// Adding a question checks the table with one probe and inserts into it,
+// so the .txt is only read again when it changed behind the index's back.
+
+const char DEDUP_MAGIC[4] = { 'Q', 'D', 'U', 'P' };
+const uint32_t DEDUP_VERSION = 1;
+const uint32_t DEDUP_MIN_SLOTS = 1024;
+
+struct DedupHeader {
+    char magic[4];       // "QDUP"
+    uint32_t version;    // DEDUP_VERSION
+    uint32_t capacity;   // number of slots (a power of two)
+    uint32_t used;       // slots holding a hash
+    FileStamp src;       // stamp of the .txt the hashes describe
+};
+
+static_assert(sizeof(DedupHeader) == 48, "dedup header must be 48 bytes");
+
+// An open duplicate index
+struct DedupIndex {
+    int fd;              // index file descriptor, -1 when closed
+    char *base;          // mapping
+    size_t size;         // mapping length
+    DedupHeader *hdr;    // header at start of mapping
+    uint64_t *slots;     // slot table after header
+
+    DedupIndex() : fd(-1), base(NULL), size(0), hdr(NULL), slots(NULL) {}
+};
+
+// Returns the duplicate index file name for a category
+string dedupFileName(const string &categoryName) {
+    return categoryStemSimple(categoryName) + ".qdup";
+}
+
+// What each byte becomes in normalized text: lowercase letters and
+// digits, bytes outside ASCII as they are (so UTF-8 text is compared
+// exactly), and 0 for everything that separates words
+struct NormTable {
+    char map[256];
+    NormTable() {
+        for (int c = 0; c < 256; c++) map[c] = c >= 0x80 || isalnum(c) ? (char)tolower(c) : 0;
+    }
+};
+const NormTable normTable;
+
+// FNV-1a 64 of the normalized form of s (its words as normTable maps
+// them, separated by single spaces), computed without building it
+uint64_t normalizedHashSimple(string_view s) {
+    uint64_t h = 14695981039346656037ULL;
+    bool gap = false, any = false;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = normTable.map[(unsigned char)s[i]];
+        if (c == 0) { gap = true; continue; }
+        if (gap && any) h = (h ^ (unsigned char)' ') * 1099511628211ULL;
+        gap = false;
+        any = true;
+        h = (h ^ (unsigned char)c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Content hash of a question: the normalized hash of its text folded with
+// those of its options in sorted order. Never 0, which marks an empty slot.
+uint64_t contentHashSimple(const Question &q) {
+    uint64_t opt[4] = { normalizedHashSimple(q.A), normalizedHashSimple(q.B),
+                        normalizedHashSimple(q.C), normalizedHashSimple(q.D) };
+    sort(opt, opt + 4);
+    uint64_t h = normalizedHashSimple(q.text);
+    for (int k = 0; k < 4; k++) {
+        h = (h ^ opt[k]) * 1099511628211ULL;
+        h ^= h >> 32;
+    }
+    return h != 0 ? h : 1;
+}
+
+// Inserts h into a slot table; false if it was already there
+bool dedupInsertSlots(uint64_t *slots, uint32_t capacity, uint64_t h) {
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = (uint32_t)h & mask; ; i = (i + 1) & mask) {
+        if (slots[i] == h) return false;
+        if (slots[i] == 0) { slots[i] = h; return true; }
+    }
+}
+
+// True if the index holds h
+bool dedupContainsSimple(const DedupIndex &ix, uint64_t h) {
+    uint32_t mask = ix.hdr->capacity - 1;
+    for (uint32_t i = (uint32_t)h & mask; ; i = (i + 1) & mask) {
+        if (ix.slots[i] == h) return true;
+        if (ix.slots[i] == 0) return false;
+    }
+}
+
+// Unmaps an index
+void closeDedupIndex(DedupIndex &ix) {
+    if (ix.base != NULL) munmap(ix.base, ix.size);
+    if (ix.fd >= 0) close(ix.fd);
+    ix.base = NULL;
+    ix.size = 0;
+    ix.hdr = NULL;
+    ix.slots = NULL;
+    ix.fd = -1;
+}
+
+// Maps an index file read-write; returns false if missing or invalid
+bool mapDedupFile(const string &fname, DedupIndex &ix) {
+    ix.fd = open(fname.c_str(), O_RDWR);
+    if (ix.fd < 0) return false;
+    struct stat sb;
+    if (fstat(ix.fd, &sb) != 0 || sb.st_size < (off_t)sizeof(DedupHeader)) { closeDedupIndex(ix); return false; }
+    void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, ix.fd, 0);
+    if (p == MAP_FAILED) { closeDedupIndex(ix); return false; }
+    ix.base = (char *)p;
+    ix.size = (size_t)sb.st_size;
+    ix.hdr = (DedupHeader *)ix.base;
+    ix.slots = (uint64_t *)(ix.base + sizeof(DedupHeader));
+    uint32_t cap = ix.hdr->capacity;
+    bool ok = memcmp(ix.hdr->magic, DEDUP_MAGIC, 4) == 0 && ix.hdr->version == DEDUP_VERSION
+        && cap >= DEDUP_MIN_SLOTS && (cap & (cap - 1)) == 0 && ix.hdr->used < cap
+        && sizeof(DedupHeader) + (size_t)cap * sizeof(uint64_t) == ix.size;
+    if (!ok) closeDedupIndex(ix);
+    return ok;
+}
+
+// Writes the index of a category from its content hashes, stamped with
+// the given .txt stamp (temp file + rename). The table is sized to stay
+// at most half full with 'room' more hashes.
+bool writeDedupIndex(const string &categoryName, const vector<uint64_t> &hashes, const FileStamp &src, uint64_t room = 0) {
+    uint32_t cap = DEDUP_MIN_SLOTS;
+    while ((uint64_t)(hashes.size() + room + 1) * 2 > cap) cap *= 2;
+    vector<uint64_t> slots(cap, 0);
+    DedupHeader h;
+    memcpy(h.magic, DEDUP_MAGIC, 4);
+    h.version = DEDUP_VERSION;
+    h.capacity = cap;
+    h.used = 0;
+    h.src = src;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        if (dedupInsertSlots(slots.data(), cap, hashes[i])) h.used++;
+    }
+
+    string fname = dedupFileName(categoryName);
+    string tmp = tempFileNameSimple(fname);
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAllSimple(fd, (const char *)&h, sizeof(h))
+        && writeAllSimple(fd, (const char *)slots.data(), slots.size() * sizeof(uint64_t));
+    close(fd);
+    if (!ok || rename(tmp.c_str(), fname.c_str()) != 0) { remove(tmp.c_str()); return false; }
+    return true;
+}
+
+// Content hashes of every question of a bank, in bank order
+void bankContentHashes(const QuestionBank &bank, vector<uint64_t> &out) {
+    out.resize(bank.count);
+    for (uint32_t i = 0; i < bank.count; i++) out[i] = contentHashSimple(bankQuestion(bank, i));
+}
+
+// Opens the index of a category, rebuilding it from the category's bank
+// when it is missing, unreadable or stamped with another version of the
+// .txt file
+bool openDedupIndex(const string &categoryName, DedupIndex &ix) {
+    FileStamp src;
+    if (!statStampSimple(categoryFileName(categoryName), src)) return false;
+    string fname = dedupFileName(categoryName);
+    if (mapDedupFile(fname, ix)) {
+        if (sameStampSimple(ix.hdr->src, src)) return true;
+        closeDedupIndex(ix);
+    }
+    vector<uint64_t> hashes;
+    bankContentHashes(*getQuestionBank(categoryName), hashes);
+    return writeDedupIndex(categoryName, hashes, src) && mapDedupFile(fname, ix);
+}
+
+// Makes room for 'more' hashes in the index of a category, rewriting it
+// large enough at once if it would pass half full
+bool dedupReserveSimple(const string &categoryName, DedupIndex &ix, uint64_t more) {
+    if ((uint64_t)(ix.hdr->used + more + 1) * 2 <= ix.hdr->capacity) return true;
+    vector<uint64_t> hashes;
+    hashes.reserve(ix.hdr->used);
+    for (uint32_t i = 0; i < ix.hdr->capacity; i++) {
+        if (ix.slots[i] != 0) hashes.push_back(ix.slots[i]);
+    }
+    FileStamp src = ix.hdr->src;
+    closeDedupIndex(ix);
+    return writeDedupIndex(categoryName, hashes, src, more) && mapDedupFile(dedupFileName(categoryName), ix);
+}
+
+// Records h in the index of a category after a question was appended to
+// its .txt, which now has the given stamp. Past half full the index is
+// rewritten twice as large.
+bool dedupAddSimple(const string &categoryName, DedupIndex &ix, uint64_t h, const FileStamp &src) {
+    if (!dedupReserveSimple(categoryName, ix, 1)) return false;
+    if (dedupInsertSlots(ix.slots, ix.hdr->capacity, h)) ix.hdr->used++;
+    ix.hdr->src = src;
+    return true;
+}
+
+// One question of the duplicate report
+struct DedupEntry {
+    uint64_t hash;       // content hash
+    uint32_t cat;        // catalog position
+    uint32_t pos;        // position in the category's bank
+};
+
+// Questions hashed per work item of the report
+const uint32_t DEDUP_CHUNK = 1 << 16;
+
+// Report worker: loads catalog banks until none are left
+void dedupLoadWorker(atomic<size_t> &next, vector<shared_ptr<const QuestionBank>> &banks) {
+    for (size_t i = next++; i < banks.size(); i = next++) banks[i] = getQuestionBank(catalog[i].name);
+}
+
+// Report worker: hashes chunks of DEDUP_CHUNK questions until none are
+// left; chunk c of the work list covers positions [first, first + CHUNK)
+// of bank 'cat', and each writes its own range of hashes[cat]
+void dedupHashWorker(atomic<size_t> &next, const vector<pair<uint32_t, uint32_t>> &chunks,
+                     const vector<shared_ptr<const QuestionBank>> &banks, vector<vector<uint64_t>> &hashes) {
+    for (size_t c = next++; c < chunks.size(); c = next++) {
+        const QuestionBank &bank = *banks[chunks[c].first];
+        vector<uint64_t> &out = hashes[chunks[c].first];
+        uint32_t end = chunks[c].second + DEDUP_CHUNK < bank.count ? chunks[c].second + DEDUP_CHUNK : bank.count;
+        for (uint32_t i = chunks[c].second; i < end; i++) out[i] = contentHashSimple(bankQuestion(bank, i));
+    }
+}
+
+// "quiz --dedup [threads=N] [limit=N]": hashes every question of every
+// category on a pool of threads, prints the duplicates found within and
+// across categories and the largest groups, and refreshes the .qdup
+// indexes that are missing or stale
+int runDedupReportSimple(int argc, char *argv[], int first) {
+    int threads = (int)thread::hardware_concurrency();
+    int limit = 10;
+    for (int i = first; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 8, "threads=") == 0) threads = atoi(arg.c_str() + 8);
+        else if (arg.compare(0, 6, "limit=") == 0) limit = atoi(arg.c_str() + 6);
+        else { cout << "Unknown option: " << arg << endl; return 1; }
+    }
+    if (threads < 1) threads = 1;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+    // load the banks, then hash them in chunks so one big category is
+    // still spread over every thread
+    vector<shared_ptr<const QuestionBank>> banks(catalog.size());
+    {
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++) pool.push_back(thread(dedupLoadWorker, ref(next), ref(banks)));
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    }
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    vector<vector<uint64_t>> hashes(catalog.size());
+    vector<pair<uint32_t, uint32_t>> chunks;
+    size_t total = 0;
+    for (size_t c = 0; c < banks.size(); c++) {
+        hashes[c].resize(banks[c]->count);
+        total += banks[c]->count;
+        for (uint32_t i = 0; i < banks[c]->count; i += DEDUP_CHUNK) chunks.push_back(make_pair((uint32_t)c, i));
+    }
+    {
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++) pool.push_back(thread(dedupHashWorker, ref(next), cref(chunks), cref(banks), ref(hashes)));
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    }
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+    // refresh the indexes whose stamp no longer matches their .txt
+    int refreshed = 0;
+    for (size_t c = 0; c < catalog.size(); c++) {
+        FileStamp src;
+        if (!statStampSimple(categoryFileName(catalog[c].name), src)) continue;
+        DedupIndex ix;
+        bool fresh = mapDedupFile(dedupFileName(catalog[c].name), ix) && sameStampSimple(ix.hdr->src, src);
+        closeDedupIndex(ix);
+        if (!fresh && writeDedupIndex(catalog[c].name, hashes[c], src)) refreshed++;
+    }
+
+    // sort all questions by hash; every run of equal hashes is a group,
+    // and each member after the first is a duplicate (within its category
+    // when the member before it is in the same category)
+    vector<DedupEntry> all;
+    all.reserve(total);
+    for (size_t c = 0; c < hashes.size(); c++) {
+        for (uint32_t i = 0; i < hashes[c].size(); i++) {
+            DedupEntry e = { hashes[c][i], (uint32_t)c, i };
+            all.push_back(e);
+        }
+    }
+    sort(all.begin(), all.end(), [](const DedupEntry &a, const DedupEntry &b) {
+        if (a.hash != b.hash) return a.hash < b.hash;
+        if (a.cat != b.cat) return a.cat < b.cat;
+        return a.pos < b.pos;
+    });
+    vector<uint64_t> within(catalog.size(), 0), elsewhere(catalog.size(), 0);
+    vector<pair<size_t, size_t>> groups; // (size, start)
+    for (size_t i = 0; i < all.size(); ) {
+        size_t j = i + 1;
+        for (; j < all.size() && all[j].hash == all[i].hash; j++) {
+            if (all[j].cat == all[j - 1].cat) within[all[j].cat]++;
+            else elsewhere[all[j].cat]++;
+        }
+        if (j - i > 1) groups.push_back(make_pair(j - i, i));
+        i = j;
+    }
+    chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+    char line[200];
+    snprintf(line, sizeof(line), "%-24s %10s %12s %12s", "category", "questions", "dup within", "dup across");
+    cout << line << endl;
+    uint64_t dupTotal = 0;
+    for (size_t c = 0; c < catalog.size(); c++) {
+        snprintf(line, sizeof(line), "%-24s %10u %12llu %12llu", catalog[c].name.c_str(), banks[c]->count,
+                 (unsigned long long)within[c], (unsigned long long)elsewhere[c]);
+        cout << line << endl;
+        dupTotal += within[c] + elsewhere[c];
+    }
+    cout << total << " questions in " << catalog.size() << " categories, " << dupTotal << " duplicates in "
+         << groups.size() << " groups" << endl;
+
+    sort(groups.begin(), groups.end(), [](const pair<size_t, size_t> &a, const pair<size_t, size_t> &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t g = 0; g < groups.size() && (int)g < limit; g++) {
+        const DedupEntry &e = all[groups[g].second];
+        string text(bankQuestion(*banks[e.cat], e.pos).text);
+        if (text.size() > 60) text = text.substr(0, 57) + "...";
+        cout << "  " << groups[g].first << "x \"" << text << "\":";
+        for (size_t k = 0; k < groups[g].first && k < 6; k++) {
+            const DedupEntry &m = all[groups[g].second + k];
+            cout << " " << catalog[m.cat].name << "#" << (m.pos + 1);
+        }
+        if (groups[g].first > 6) cout << " ...";
+        cout << endl;
+    }
+    cout << "Loaded in " << chrono::duration<double, milli>(t1 - t0).count() << " ms, hashed on " << threads
+         << " threads in " << chrono::duration<double, milli>(t2 - t1).count() << " ms, grouped in "
+         << chrono::duration<double, milli>(t3 - t2).count() << " ms; " << refreshed << " indexes refreshed" << endl;
+    saveCatalogSimple();
+    return 0;
+}
+
+// ---------- BULK IMPORT ----------
+
+// "quiz --import FILE" adds questions from a CSV, TSV or JSON-lines file
+// to the category files. Each row is one question with the columns
+//   question, A, B, C, D, answer, diff, category
+// in that order, or in any order under a header row naming them (CSV and
+// TSV), or as the keys of one JSON object per line. The category column
+// may be left out when category=NAME is given. The file is read in one go
+// and split at line ends into chunks that worker threads parse, validate,
+// hash and format into Q:/A)/ANSWER:/DIFF:/--- records. A single pass then
+// takes the rows in file order, drops duplicates through each category's
+// duplicate index (and of each other), and every category file receives
+// its new records in one append. Question files are line based, so no
+// field may span lines: a CSV quoted field ends on its line, and a JSON
+// "\n" in a field is rejected.
+
+enum ImportFormat { IMPORT_CSV, IMPORT_TSV, IMPORT_JSONL };
+
+enum ImportColumn { COL_QUESTION, COL_A, COL_B, COL_C, COL_D, COL_ANSWER, COL_DIFF, COL_CATEGORY, COL_COUNT };
+
+struct ImportConfig {
+    string file;         // input file
+    ImportFormat format; // how rows are written
+    string category;     // category of rows that name none ("" = required per row)
+    int threads;         // parse threads
+    bool dedup;          // skip rows already in their category
+    bool compile;        // rebuild the .qbank of every category written
+};
+
+// A rejected row
+struct ImportError {
+    uint64_t line;       // line in the input file (1-based)
+    string message;
+};
+
+// Outcome of an import
+struct ImportReport {
+    uint64_t bytes;      // input size
+    uint64_t rows;       // non-blank data rows
+    uint64_t imported;   // rows written to category files
+    uint64_t invalid;    // rows that failed validation
+    uint64_t duplicates; // rows skipped as duplicates
+    vector<ImportError> errors;       // invalid and duplicate rows, in line order
+    map<string, uint64_t> perCategory; // rows written per category
+    vector<string> unchecked;         // categories whose duplicate index could not be opened
+    double parseMs, mergeMs, writeMs, totalMs;
+};
+
+// A valid row, formatted into its chunk's output
+struct ImportRow {
+    uint64_t line;       // line within the chunk (0-based)
+    uint32_t cat;        // index into the chunk's category names
+    uint64_t hash;       // content hash (see DUPLICATE INDEX)
+    size_t off;          // record bytes in the chunk's output
+    size_t len;
+};
+
+// One piece of the input and what its worker made of it
+struct ImportChunk {
+    const char *begin;   // first byte (start of a line)
+    const char *end;     // one past the last line's '\n' (or end of input)
+    uint64_t lines;      // lines in the chunk
+    string out;          // formatted records of the valid rows
+    vector<string> cats; // categories named by the chunk's rows
+    vector<ImportRow> rows;
+    vector<ImportError> errors; // line is within the chunk (0-based)
+};
+
+// Column of a header or JSON key name, -1 if unknown
+int importColumnSimple(string_view name) {
+    string n;
+    for (size_t i = 0; i < name.size(); i++) n += (char)tolower((unsigned char)name[i]);
+    if (n == "question" || n == "text" || n == "q") return COL_QUESTION;
+    if (n == "a") return COL_A;
+    if (n == "b") return COL_B;
+    if (n == "c") return COL_C;
+    if (n == "d") return COL_D;
+    if (n == "answer" || n == "correct") return COL_ANSWER;
+    if (n == "diff" || n == "difficulty") return COL_DIFF;
+    if (n == "category") return COL_CATEGORY;
+    return -1;
+}
+
+// Splits one CSV or TSV line into fields, reusing the strings of 'fields';
+// returns the field count, or -1 with err set. With quotes, a field that
+// starts with '"' runs to the closing quote and "" stands for one quote.
+int splitDelimitedSimple(string_view s, char sep, bool quotes, vector<string> &fields, string &err) {
+    size_t n = 0;
+    size_t i = 0;
+    while (true) {
+        if (n == fields.size()) fields.push_back(string());
+        string &f = fields[n++];
+        f.clear();
+        if (quotes && i < s.size() && s[i] == '"') {
+            i++;
+            while (true) {
+                if (i >= s.size()) { err = "unterminated quoted field"; return -1; }
+                if (s[i] == '"') {
+                    if (i + 1 < s.size() && s[i + 1] == '"') { f += '"'; i += 2; continue; }
+                    i++;
+                    break;
+                }
+                f += s[i++];
+            }
+            if (i < s.size() && s[i] != sep) { err = "text after a closing quote"; return -1; }
+        } else {
+            size_t j = s.find(sep, i);
+            if (j == string_view::npos) j = s.size();
+            f.assign(s.data() + i, j - i);
+            i = j;
+        }
+        if (i >= s.size()) return (int)n;
+        i++; // separator; a line ending in one has an empty last field
+    }
+}
+
+// Appends code point cp to out as UTF-8
+void appendUtf8Simple(string &out, uint32_t cp) {
+    if (cp < 0x80) out += (char)cp;
+    else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+    else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+// Reads 4 hex digits at s[i]; -1 if they are not hex
+long readHex4Simple(string_view s, size_t i) {
+    if (i + 4 > s.size()) return -1;
+    long v = 0;
+    for (size_t k = i; k < i + 4; k++) {
+        char c = s[k];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0) return -1;
+        v = v * 16 + d;
+    }
+    return v;
+}
+
+// Reads the JSON string starting at the quote s[i] into out and moves i
+// past it; false with err set if it is malformed
+bool readJsonStringSimple(string_view s, size_t &i, string &out, string &err) {
+    out.clear();
+    i++;
+    while (i < s.size()) {
+        char c = s[i++];
+        if (c == '"') return true;
+        if ((unsigned char)c < 0x20) { err = "control character in a string"; return false; }
+        if (c != '\\') { out += c; continue; }
+        if (i >= s.size()) break;
+        char e = s[i++];
+        if (e == '"' || e == '\\' || e == '/') out += e;
+        else if (e == 'b') out += '\b';
+        else if (e == 'f') out += '\f';
+        else if (e == 'n') out += '\n';
+        else if (e == 'r') out += '\r';
+        else if (e == 't') out += '\t';
+        else if (e == 'u') {
+            long cp = readHex4Simple(s, i);
+            if (cp < 0) { err = "bad \\u escape"; return false; }
+            i += 4;
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < s.size() && s[i] == '\\' && s[i + 1] == 'u') {
+                long lo = readHex4Simple(s, i + 2);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 6;
+                }
+            }
+            appendUtf8Simple(out, (uint32_t)cp);
+        }
+        else { err = "bad escape in a string"; return false; }
+    }
+    err = "unterminated string";
+    return false;
+}
+
+// Parses one JSON object of a JSON-lines file into the row's columns.
+// Values are strings, numbers or literals (null gives an empty field);
+// keys that name no column are skipped, nested values are refused.
+bool parseJsonRowSimple(string_view s, string f[], string &key, string &val, string &err) {
+    size_t i = 0;
+    while (i < s.size() && scanSpace(s[i])) i++;
+    if (i >= s.size() || s[i] != '{') { err = "expected a JSON object"; return false; }
+    i++;
+    while (i < s.size() && scanSpace(s[i])) i++;
+    if (i < s.size() && s[i] == '}') i++;
+    else {
+        while (true) {
+            if (i >= s.size() || s[i] != '"') { err = "expected a key"; return false; }
+            if (!readJsonStringSimple(s, i, key, err)) return false;
+            while (i < s.size() && scanSpace(s[i])) i++;
+            if (i >= s.size() || s[i] != ':') { err = "expected ':' after a key"; return false; }
+            i++;
+            while (i < s.size() && scanSpace(s[i])) i++;
+            if (i >= s.size()) { err = "missing value"; return false; }
+            if (s[i] == '"') {
+                if (!readJsonStringSimple(s, i, val, err)) return false;
+            } else if (s[i] == '{' || s[i] == '[') {
+                err = "nested values are not supported";
+                return false;
+            } else {
+                size_t j = i;
+                while (j < s.size() && s[j] != ',' && s[j] != '}' && !scanSpace(s[j])) j++;
+                val.assign(s.data() + i, j - i);
+                if (val == "null") val.clear();
+                i = j;
+            }
+            int col = importColumnSimple(key);
+            if (col >= 0) f[col] = val;
+            while (i < s.size() && scanSpace(s[i])) i++;
+            if (i < s.size() && s[i] == ',') {
+                i++;
+                while (i < s.size() && scanSpace(s[i])) i++;
+                continue;
+            }
+            if (i < s.size() && s[i] == '}') { i++; break; }
+            err = "expected ',' or '}'";
+            return false;
+        }
+    }
+    while (i < s.size() && scanSpace(s[i])) i++;
+    if (i != s.size()) { err = "text after the object"; return false; }
+    return true;
+}
+
+// True if a category name is safe as a file name and in the manifest
+bool validCategoryName(string_view name) {
+    if (name.empty() || name.size() > 63 || name[0] == '.' || name[0] == ' ') return false;
+    for (size_t i = 0; i < name.size(); i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (!isalnum(c) && c != '_' && c != '-' && c != '.' && c != ' ') return false;
+    }
+    return true;
+}
+
+// Checks the columns of a row in place (fields are trimmed, answer and
+// difficulty upper-cased); false with err set if the row cannot be a
+// question
+bool validateImportRow(string f[], string &err) {
+    static const char *const names[COL_COUNT] = { "question", "option A", "option B", "option C", "option D",
+                                                  "answer", "difficulty", "category" };
+    for (int k = 0; k < COL_COUNT; k++) {
+        size_t b = 0, e = f[k].size();
+        while (b < e && scanSpace(f[k][b])) b++;
+        while (e > b && scanSpace(f[k][e - 1])) e--;
+        if (e < f[k].size()) f[k].erase(e);
+        if (b > 0) f[k].erase(0, b);
+        bool breaks = false;
+        for (size_t i = 0; i < f[k].size(); i++) breaks |= f[k][i] == '\n' || f[k][i] == '\r';
+        if (breaks) { err = string(names[k]) + " spans lines"; return false; }
+        if (f[k].empty()) {
+            err = k == COL_CATEGORY ? "no category (add a category column or category=NAME)" : "missing " + string(names[k]);
+            return false;
+        }
+    }
+    if (f[COL_ANSWER].size() != 1 || upchar(f[COL_ANSWER][0]) < 'A' || upchar(f[COL_ANSWER][0]) > 'D') {
+        err = "ANSWER must be A, B, C or D (got \"" + f[COL_ANSWER] + "\")";
+        return false;
+    }
+    if (f[COL_DIFF].size() != 1 || diffSlot(upchar(f[COL_DIFF][0])) < 0) {
+        err = "DIFF must be E, M or H (got \"" + f[COL_DIFF] + "\")";
+        return false;
+    }
+    if (!validCategoryName(f[COL_CATEGORY])) {
+        err = "bad category name \"" + f[COL_CATEGORY] + "\"";
+        return false;
+    }
+    f[COL_ANSWER][0] = upchar(f[COL_ANSWER][0]);
+    f[COL_DIFF][0] = upchar(f[COL_DIFF][0]);
+    return true;
+}
+
+// Import worker: takes chunks until none are left and turns each line
+// into a formatted record or an error. colOf maps a CSV/TSV field position
+// to its column (-1 = ignored).
+void importWorkerSimple(atomic<size_t> &next, vector<ImportChunk> &chunks, const ImportConfig &cfg, const vector<int> &colOf) {
+    string f[COL_COUNT];
+    vector<string> fields;
+    string key, val, err;
+    for (size_t c = next++; c < chunks.size(); c = next++) {
+        ImportChunk &ch = chunks[c];
+        ch.lines = 0;
+        // a record is its row plus about 40 bytes of prefixes
+        ch.out.reserve((size_t)(ch.end - ch.begin) * 3 / 2);
+        const char *p = ch.begin;
+        while (p < ch.end) {
+            const char *nl = findNewlineSimple(p, ch.end);
+            string_view line(p, (size_t)(nl - p));
+            uint64_t li = ch.lines++;
+            p = nl + 1;
+            if (simpleTrim(line).empty()) continue;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            for (int k = 0; k < COL_COUNT; k++) f[k].clear();
+            bool ok;
+            if (cfg.format == IMPORT_JSONL) {
+                ok = parseJsonRowSimple(line, f, key, val, err);
+            } else {
+                int n = splitDelimitedSimple(line, cfg.format == IMPORT_TSV ? '\t' : ',', cfg.format == IMPORT_CSV, fields, err);
+                ok = n >= 0;
+                if (ok && n != (int)colOf.size() && !(colOf.size() == COL_COUNT && n == COL_COUNT - 1)) {
+                    err = "expected " + to_string(colOf.size()) + " fields, got " + to_string(n);
+                    ok = false;
+                }
+                for (int k = 0; ok && k < n; k++) {
+                    if (colOf[k] >= 0) f[colOf[k]].swap(fields[k]);
+                }
+            }
+            if (ok && f[COL_CATEGORY].empty()) f[COL_CATEGORY] = cfg.category;
+            if (!ok || !validateImportRow(f, err)) {
+                ImportError e = { li, err };
+                ch.errors.push_back(e);
+                continue;
+            }
+
+            ImportRow row;
+            row.line = li;
+            row.cat = 0;
+            while (row.cat < ch.cats.size() && ch.cats[row.cat] != f[COL_CATEGORY]) row.cat++;
+            if (row.cat == ch.cats.size()) ch.cats.push_back(f[COL_CATEGORY]);
+            Question q;
+            q.diff = f[COL_DIFF][0];
+            q.correct = f[COL_ANSWER][0];
+            q.text = f[COL_QUESTION];
+            q.A = f[COL_A];
+            q.B = f[COL_B];
+            q.C = f[COL_C];
+            q.D = f[COL_D];
+            row.hash = contentHashSimple(q);
+            row.off = ch.out.size();
+            ch.out += "Q: "; ch.out += f[COL_QUESTION];
+            ch.out += "\nA) "; ch.out += f[COL_A];
+            ch.out += "\nB) "; ch.out += f[COL_B];
+            ch.out += "\nC) "; ch.out += f[COL_C];
+            ch.out += "\nD) "; ch.out += f[COL_D];
+            ch.out += "\nANSWER: "; ch.out += q.correct;
+            ch.out += "\nDIFF: "; ch.out += q.diff;
+            ch.out += "\n---\n";
+            row.len = ch.out.size() - row.off;
+            ch.rows.push_back(row);
+        }
+    }
+}
+
+// A category file receiving rows, with its duplicate index. Accepted
+// hashes wait in 'pending' and only reach the index once the records are
+// in the .txt, so a failed append leaves the index as it was.
+struct ImportTarget {
+    string out;          // records to append
+    DedupIndex ix;       // duplicate index (when dedup is on)
+    bool indexed;        // ix is open
+    vector<uint64_t> pending; // slot table of the hashes accepted so far
+    FileStamp src;       // .txt stamp before the import
+    uint64_t added;
+};
+
+// Imports cfg.file into the category files; false (with a message) if
+// the input cannot be read or a category file cannot be written
+bool importQuestionsSimple(const ImportConfig &cfg, ImportReport &rep, string &fatal) {
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    rep.bytes = rep.rows = rep.imported = rep.invalid = rep.duplicates = 0;
+    rep.errors.clear();
+    rep.perCategory.clear();
+    rep.unchecked.clear();
+    rep.parseMs = rep.mergeMs = rep.writeMs = rep.totalMs = 0;
+
+    string data;
+    if (!readWholeFile(cfg.file, data)) { fatal = "Cannot read " + cfg.file; return false; }
+    rep.bytes = data.size();
+    const char *p = data.data();
+    const char *end = p + data.size();
+    if (data.compare(0, 3, "\xEF\xBB\xBF") == 0) p += 3; // UTF-8 byte order mark
+
+    // CSV and TSV: a first line made only of column names is a header
+    uint64_t firstLine = 0;
+    vector<int> colOf;
+    for (int k = 0; k < COL_COUNT; k++) colOf.push_back(k);
+    if (cfg.format != IMPORT_JSONL) {
+        const char *q = p;
+        while (q < end) {
+            const char *nl = findNewlineSimple(q, end);
+            string_view line(q, (size_t)(nl - q));
+            if (simpleTrim(line).empty()) { q = nl + 1; firstLine++; continue; }
+            if (line.back() == '\r') line.remove_suffix(1);
+            vector<string> fields;
+            string err;
+            int n = splitDelimitedSimple(line, cfg.format == IMPORT_TSV ? '\t' : ',', cfg.format == IMPORT_CSV, fields, err);
+            vector<int> named;
+            bool header = n > 0;
+            for (int k = 0; header && k < n; k++) {
+                named.push_back(importColumnSimple(simpleTrim(fields[k])));
+                header = named.back() >= 0;
+            }
+            if (header) {
+                colOf = named;
+                p = nl + 1 < end ? nl + 1 : end;
+                firstLine++;
+            }
+            break;
+        }
+        if (p > end) p = end;
+    }
+
+    // chunks of about equal size, each ending at a line end
+    int threads = cfg.threads > 0 ? cfg.threads : 1;
+    size_t want = (size_t)threads * 4;
+    size_t step = (size_t)(end - p) / want + 1;
+    vector<ImportChunk> chunks;
+    while (p < end) {
+        ImportChunk ch;
+        ch.begin = p;
+        const char *stop = (size_t)(end - p) > step ? p + step : end;
+        stop = stop < end ? findNewlineSimple(stop, end) : end;
+        ch.end = stop < end ? stop + 1 : end;
+        ch.lines = 0;
+        chunks.push_back(ch);
+        p = ch.end;
+    }
+    {
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for (int t = 0; t < threads; t++) pool.push_back(thread(importWorkerSimple, ref(next), ref(chunks), cref(cfg), cref(colOf)));
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    }
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+    // open every category written to, with room in its index and in its
+    // pending table for all of its rows
+    map<string, ImportTarget> targets;
+    vector<vector<ImportTarget *>> chunkTargets(chunks.size());
+    for (size_t c = 0; c < chunks.size(); c++) {
+        const ImportChunk &ch = chunks[c];
+        for (size_t k = 0; k < ch.cats.size(); k++) {
+            map<string, ImportTarget>::iterator it = targets.find(ch.cats[k]);
+            if (it == targets.end()) {
+                ImportTarget &t = targets[ch.cats[k]];
+                t.indexed = false;
+                t.added = 0;
+                string fname = categoryFileName(ch.cats[k]);
+                if (!fileExistsSimple(fname)) ofstream(fname.c_str(), ios::app);
+                if (!statStampSimple(fname, t.src)) { fatal = "Cannot create " + fname; return false; }
+                if (cfg.dedup) t.indexed = openDedupIndex(ch.cats[k], t.ix);
+                it = targets.find(ch.cats[k]);
+            }
+            chunkTargets[c].push_back(&it->second);
+        }
+        for (size_t r = 0; r < ch.rows.size(); r++) chunkTargets[c][ch.rows[r].cat]->added++;
+    }
+    for (map<string, ImportTarget>::iterator it = targets.begin(); it != targets.end(); ++it) {
+        ImportTarget &t = it->second;
+        if (t.indexed) t.indexed = dedupReserveSimple(it->first, t.ix, t.added);
+        if (cfg.dedup && !t.indexed) rep.unchecked.push_back(it->first);
+        if (cfg.dedup) {
+            size_t cap = 16;
+            while ((t.added + 1) * 2 > cap) cap *= 2;
+            t.pending.assign(cap, 0);
+        }
+        t.added = 0;
+    }
+
+    // take the rows in file order: the first copy of a question wins
+    uint64_t lineBase = firstLine;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        ImportChunk &ch = chunks[c];
+        const vector<ImportTarget *> &tg = chunkTargets[c];
+        for (size_t r = 0; r < ch.rows.size(); r++) {
+            const ImportRow &row = ch.rows[r];
+            ImportTarget &t = *tg[row.cat];
+            if (cfg.dedup) {
+                if ((t.indexed && dedupContainsSimple(t.ix, row.hash))
+                    || !dedupInsertSlots(t.pending.data(), (uint32_t)t.pending.size(), row.hash)) {
+                    rep.duplicates++;
+                    ImportError e = { lineBase + row.line + 1, "duplicate of a question already in " + ch.cats[row.cat] };
+                    rep.errors.push_back(e);
+                    continue;
+                }
+            }
+            t.out.append(ch.out, row.off, row.len);
+            t.added++;
+        }
+        for (size_t k = 0; k < ch.errors.size(); k++) {
+            ImportError e = { lineBase + ch.errors[k].line + 1, ch.errors[k].message };
+            rep.errors.push_back(e);
+        }
+        rep.rows += ch.rows.size() + ch.errors.size();
+        rep.invalid += ch.errors.size();
+        lineBase += ch.lines;
+        string().swap(ch.out);
+    }
+    sort(rep.errors.begin(), rep.errors.end(), [](const ImportError &a, const ImportError &b) { return a.line < b.line; });
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+    // one append per category file, after a '\n' if the file lacks one
+    bool ok = true;
+    for (map<string, ImportTarget>::iterator it = targets.begin(); it != targets.end(); ++it) {
+        ImportTarget &t = it->second;
+        string fname = categoryFileName(it->first);
+        if (!t.out.empty()) {
+            int fd = open(fname.c_str(), O_RDWR | O_APPEND);
+            char last = '\n';
+            bool written = fd >= 0;
+            if (written && t.src.size > 0) written = pread(fd, &last, 1, (off_t)t.src.size - 1) == 1;
+            if (written && last != '\n') written = writeAllSimple(fd, "\n", 1);
+            written = written && writeAllSimple(fd, t.out.data(), t.out.size());
+            if (fd >= 0) close(fd);
+            if (!written) {
+                // the index keeps the old stamp, so a partial append makes
+                // it stale and the next open rebuilds it
+                fatal = "Cannot write " + fname;
+                ok = false;
+                closeDedupIndex(t.ix);
+                continue;
+            }
+            rep.imported += t.added;
+            rep.perCategory[it->first] = t.added;
+        }
+        FileStamp src;
+        if (t.indexed && statStampSimple(fname, src)) {
+            for (size_t i = 0; i < t.pending.size(); i++) {
+                if (t.pending[i] != 0 && dedupInsertSlots(t.ix.slots, t.ix.hdr->capacity, t.pending[i])) t.ix.hdr->used++;
+            }
+            t.ix.hdr->src = src;
+        }
+        closeDedupIndex(t.ix);
+        if (ok && cfg.compile && t.added > 0) compileQuestionBank(it->first);
+    }
+    chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+    rep.parseMs = chrono::duration<double, milli>(t1 - t0).count();
+    rep.mergeMs = chrono::duration<double, milli>(t2 - t1).count();
+    rep.writeMs = chrono::duration<double, milli>(t3 - t2).count();
+    rep.totalMs = chrono::duration<double, milli>(t3 - t0).count();
+    return ok;
+}
+
+// "quiz --import FILE [category=NAME] [format=csv|tsv|jsonl] [threads=N]
+// [dedup=0] [compile=1] [errors=N]": imports FILE and prints the rows
+// written per category, throughput and the first N rejected rows. Exits
+// with 1 if the import failed and 2 if rows were invalid.
+int runImportSimple(int argc, char *argv[], int first) {
+    if (first >= argc) { cout << "Usage: quiz --import FILE [category=NAME] [format=csv|tsv|jsonl] [threads=N] [dedup=0] [compile=1] [errors=N]" << endl; return 1; }
+    ImportConfig cfg;
+    cfg.file = argv[first];
+    cfg.threads = (int)thread::hardware_concurrency();
+    cfg.dedup = true;
+    cfg.compile = false;
+    string ext = cfg.file.substr(cfg.file.find_last_of('.') + 1);
+    cfg.format = ext == "tsv" || ext == "tab" ? IMPORT_TSV : ext == "jsonl" || ext == "json" || ext == "ndjson" ? IMPORT_JSONL : IMPORT_CSV;
+    int shown = 20;
+    for (int i = first + 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 9, "category=") == 0) cfg.category = arg.substr(9);
+        else if (arg == "format=csv") cfg.format = IMPORT_CSV;
+        else if (arg == "format=tsv") cfg.format = IMPORT_TSV;
+        else if (arg == "format=jsonl") cfg.format = IMPORT_JSONL;
+        else if (arg.compare(0, 8, "threads=") == 0) cfg.threads = atoi(arg.c_str() + 8);
+        else if (arg.compare(0, 6, "dedup=") == 0) cfg.dedup = arg != "dedup=0";
+        else if (arg.compare(0, 8, "compile=") == 0) cfg.compile = arg != "compile=0";
+        else if (arg.compare(0, 7, "errors=") == 0) shown = atoi(arg.c_str() + 7);
+        else { cout << "Unknown option: " << arg << endl; return 1; }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (shown < 0) shown = 0;
+    if (!cfg.category.empty() && !validCategoryName(cfg.category)) { cout << "Bad category name: " << cfg.category << endl; return 1; }
+
+    ImportReport rep;
+    string fatal;
+    bool ok = importQuestionsSimple(cfg, rep, fatal);
+    if (!fatal.empty()) cout << fatal << endl;
+    if (!ok && rep.rows == 0) return 1;
+    cout << "Imported " << rep.imported << " of " << rep.rows << " rows (" << rep.invalid << " invalid, "
+         << rep.duplicates << " duplicates) into " << rep.perCategory.size() << " categories" << endl;
+    for (map<string, uint64_t>::const_iterator it = rep.perCategory.begin(); it != rep.perCategory.end(); ++it) {
+        cout << "  " << it->first << ": +" << it->second << endl;
+    }
+    for (size_t i = 0; i < rep.unchecked.size(); i++) {
+        cout << "Warning: the duplicate index of " << rep.unchecked[i]
+             << " could not be opened; its rows were only checked against each other" << endl;
+    }
+    char line[200];
+    snprintf(line, sizeof(line), "%s in %.1f ms (parse %.1f ms on %d threads, merge %.1f ms, write %.1f ms): %.0f rows/s, %.1f MB/s",
+             formatBytesSimple(rep.bytes).c_str(), rep.totalMs, rep.parseMs, cfg.threads, rep.mergeMs, rep.writeMs,
+             rep.totalMs > 0 ? rep.rows * 1000.0 / rep.totalMs : 0.0,
+             rep.totalMs > 0 ? rep.bytes / (1024.0 * 1024.0) / (rep.totalMs / 1000.0) : 0.0);
+    cout << line << endl;
+    for (size_t i = 0; i < rep.errors.size() && i < (size_t)shown; i++) {
+        cout << "line " << rep.errors[i].line << ": " << rep.errors[i].message << endl;
+    }
+    if (rep.errors.size() > (size_t)shown) cout << "... and " << rep.errors.size() - shown << " more" << endl;
+    if (!ok) return 1;
+    return rep.invalid > 0 ? 2 : 0;
+}
+
+// ---------- ASYNC FILE WRITER ----------
+
+// Log and score lines are handed to one background thread through a
+// bounded lock-free queue (Vyukov's MPMC ring: each cell carries a
+// sequence number that tells producers and the consumer whose turn it
+// is). The writer batches lines per file and writes a batch once it
+// reaches asyncFlushBytes, every asyncFlushMs, and at shutdown, so the
+// game thread never waits on the disk. When the queue is full, log lines
+// are dropped and score lines wait for space (back-pressure), up to
+// asyncWaitMs; past that the line is appended directly. All are counted.
+
+const size_t ASYNC_QUEUE_CELLS = 4096;   // power of two
+
+// Batch size that triggers a write
+size_t asyncFlushBytes = 64 * 1024;
+
+// Longest time a line may sit in a batch
+int asyncFlushMs = 200;
+
+// Longest time a score line waits for queue space before it is written
+// by the caller instead
+int asyncWaitMs = 2000;
+
+// An output file of the writer
+struct AsyncTarget {
+    string path;                        // file appended to
+    int fd;                             // writer-side descriptor
+    string batch;                       // lines waiting to be written
+    atomic<uint64_t> pendingBytes;      // queued or batched, not yet written
+};
+
+// One queue cell
+struct AsyncCell {
+    atomic<size_t> seq;                 // turn marker (see above)
+    AsyncTarget *target;                // file the line goes to
+    string text;                        // the line, newline included
+};
+
+// Counters reported by the writer
+struct AsyncWriterStats {
+    unsigned long long enqueued;        // lines accepted
+    unsigned long long written;         // lines written to disk
+    unsigned long long dropped;         // log lines dropped on a full queue
+    unsigned long long backpressured;   // score lines that had to wait
+    unsigned long long direct;          // score lines written by the caller after waiting too long
+    unsigned long long flushes;         // write() batches
+};
+
+struct AsyncWriter {
+    unique_ptr<AsyncCell[]> cells;
+    atomic<size_t> enqueuePos;
+    atomic<size_t> dequeuePos;
+    atomic<bool> running;
+    atomic<bool> stopping;
+    thread worker;
+    mutex targetsLock;                  // guards 'targets' and start/stop
+    map<string, unique_ptr<AsyncTarget> > targets;
+    mutex spaceLock;                    // with spaceFree, wakes back-pressured callers
+    condition_variable spaceFree;
+    atomic<int> waiting;                // callers waiting for space
+    atomic<unsigned long long> enqueued, written, dropped, backpressured, direct, flushes;
+};
+
+AsyncWriter asyncWriter;
+
+// Pushes one line; returns false if the queue is full
+bool tryEnqueueLine(AsyncTarget *t, string &text) {
+    AsyncCell *cells = asyncWriter.cells.get();
+    size_t pos = asyncWriter.enqueuePos.load(memory_order_relaxed);
+    AsyncCell *c;
+    while (true) {
+        c = &cells[pos & (ASYNC_QUEUE_CELLS - 1)];
+        size_t seq = c->seq.load(memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (asyncWriter.enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = asyncWriter.enqueuePos.load(memory_order_relaxed);
+        }
+    }
+    c->target = t;
+    c->text.swap(text);
+    c->seq.store(pos + 1, memory_order_release);
+    return true;
+}
+
+// Pops one line; returns false if the queue is empty
+bool tryDequeueLine(AsyncTarget *&t, string &text) {
+    AsyncCell *cells = asyncWriter.cells.get();
+    size_t pos = asyncWriter.dequeuePos.load(memory_order_relaxed);
+    AsyncCell *c;
+    while (true) {
+        c = &cells[pos & (ASYNC_QUEUE_CELLS - 1)];
+        size_t seq = c->seq.load(memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (asyncWriter.dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = asyncWriter.dequeuePos.load(memory_order_relaxed);
+        }
+    }
+    t = c->target;
+    text.swap(c->text);
+    c->text.clear();
+    c->seq.store(pos + ASYNC_QUEUE_CELLS, memory_order_release);
+    return true;
+}
+
+// Writes a target's batch to disk (writer thread only)
+void flushAsyncTarget(AsyncTarget &t) {
+    if (t.batch.empty()) return;
+    if (t.fd < 0) t.fd = open(t.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (t.fd >= 0) writeAllSimple(t.fd, t.batch.data(), t.batch.size());
+    t.pendingBytes.fetch_sub(t.batch.size());
+    asyncWriter.flushes++;
+    t.batch.clear();
+}
+
+// Writer thread: drain the queue into batches, write on size/time/stop.
+// Targets are never removed, so the timed flush copies their pointers
+// under targetsLock and writes without holding it.
+void asyncWriterLoop() {
+    AsyncTarget *t;
+    string text;
+    vector<AsyncTarget *> all;
+    chrono::steady_clock::time_point lastFlush = chrono::steady_clock::now();
+    while (true) {
+        bool stopping = asyncWriter.stopping.load();
+        bool got = false;
+        while (tryDequeueLine(t, text)) {
+            got = true;
+            t->batch += text;
+            asyncWriter.written++;
+            if (t->batch.size() >= asyncFlushBytes) flushAsyncTarget(*t);
+        }
+        if (got && asyncWriter.waiting.load() > 0) {
+            lock_guard<mutex> guard(asyncWriter.spaceLock);
+            asyncWriter.spaceFree.notify_all();
+        }
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (stopping || now - lastFlush >= chrono::milliseconds(asyncFlushMs)) {
+            all.clear();
+            {
+                lock_guard<mutex> guard(asyncWriter.targetsLock);
+                for (map<string, unique_ptr<AsyncTarget> >::iterator it = asyncWriter.targets.begin(); it != asyncWriter.targets.end(); ++it) {
+                    all.push_back(it->second.get());
+                }
+            }
+            for (size_t i = 0; i < all.size(); i++) flushAsyncTarget(*all[i]);
+            lastFlush = now;
+        }
+        if (stopping && !got) break;
+        if (!got) this_thread::sleep_for(chrono::milliseconds(asyncFlushMs < 10 ? asyncFlushMs : 10));
+    }
+}
+
+// Returns the writer target of a file, starting the writer on first use
+AsyncTarget *asyncTargetFor(const string &path) {
+    lock_guard<mutex> guard(asyncWriter.targetsLock);
+    if (!asyncWriter.running.load()) {
+        asyncWriter.cells.reset(new AsyncCell[ASYNC_QUEUE_CELLS]);
+        for (size_t i = 0; i < ASYNC_QUEUE_CELLS; i++) asyncWriter.cells[i].seq.store(i);
+        asyncWriter.enqueuePos = 0;
+        asyncWriter.dequeuePos = 0;
+        asyncWriter.stopping = false;
+        asyncWriter.running = true;
+        asyncWriter.worker = thread(asyncWriterLoop);
+    }
+    unique_ptr<AsyncTarget> &slot = asyncWriter.targets[path];
+    if (!slot) {
+        slot.reset(new AsyncTarget());
+        slot->path = path;
+        slot->fd = -1;
+        slot->pendingBytes = 0;
+    }
+    return slot.get();
+}
+
+// Queues a line for a file. Lines that must not be lost (scores) wait
+// for queue space, and are appended directly if none frees up within
+// asyncWaitMs; other lines are dropped when the queue is full.
+// Returns false if the line was dropped.
+bool asyncAppendLine(AsyncTarget *t, string &text, bool mustKeep) {
+    size_t n = text.size();
+    t->pendingBytes.fetch_add(n);
+    if (tryEnqueueLine(t, text)) { asyncWriter.enqueued++; return true; }
+    if (!mustKeep) {
+        t->pendingBytes.fetch_sub(n);
+        asyncWriter.dropped++;
+        return false;
+    }
+    asyncWriter.backpressured++;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(asyncWaitMs);
+    bool queued = false;
+    asyncWriter.waiting++;
+    {
+        unique_lock<mutex> lk(asyncWriter.spaceLock);
+        while (!(queued = tryEnqueueLine(t, text)) && chrono::steady_clock::now() < deadline) {
+            asyncWriter.spaceFree.wait_for(lk, chrono::milliseconds(10));
+        }
+    }
+    asyncWriter.waiting--;
+    if (queued) { asyncWriter.enqueued++; return true; }
+    ofstream out(t->path.c_str(), ios::app);
+    out << text;
+    t->pendingBytes.fetch_sub(n);
+    asyncWriter.direct++;
+    return true;
+}
+
+// Drains the queue, writes every batch and stops the writer (called at exit)
+void stopAsyncWriter() {
+    {
+        lock_guard<mutex> guard(asyncWriter.targetsLock);
+        if (!asyncWriter.running.load()) return;
+        asyncWriter.stopping = true;
+    }
+    asyncWriter.worker.join();
+    lock_guard<mutex> guard(asyncWriter.targetsLock);
+    for (map<string, unique_ptr<AsyncTarget> >::iterator it = asyncWriter.targets.begin(); it != asyncWriter.targets.end(); ++it) {
+        if (it->second->fd >= 0) close(it->second->fd);
+        it->second->fd = -1;
+    }
+    asyncWriter.running = false;
+}
+
+// Returns a snapshot of the writer counters
+AsyncWriterStats getAsyncWriterStats() {
+    AsyncWriterStats s;
+    s.enqueued = asyncWriter.enqueued;
+    s.written = asyncWriter.written;
+    s.dropped = asyncWriter.dropped;
+    s.backpressured = asyncWriter.backpressured;
+    s.direct = asyncWriter.direct;
+    s.flushes = asyncWriter.flushes;
+    return s;
+}
+
+// ---------- HIGH SCORE FUNCTIONS ----------
+
+// high_scores.txt is the append-only history of every score, one line
+// "name|score|time|category|difficulty" (lines from older versions stop
+// after the time). Scores are indexed per leaderboard key: "" for the
+// overall board and "<category>/<E|M|H>" for each category/difficulty.
+// Each key keeps its best MAX_HIGHS rows and a Fenwick tree of score
+// counts, so "rank of score X" is O(log buckets) however many scores
+// exist. The index file (QuizPaths::topScores) also stores how many history
+// bytes are folded in, so only newer lines are ever read again:
+//   QTOP 1 <history bytes indexed>
+//   K <rows> <key>               then rows "<score>|<time>|<name>"
+//   F <bucket>:<count> ...       nonzero score buckets of that key
+// The key runs to the end of its line, since category names may contain
+// spaces.
+
+// Score range tracked exactly by the rank trees; scores outside it are
+// ranked as if they were at the nearest end
+const int SCORE_MIN = -1000;
+const int SCORE_MAX = 1000;
+const int SCORE_BUCKETS = SCORE_MAX - SCORE_MIN + 1;
+
+// Folded history lines between index file rewrites (also written at exit)
+int boardPersistEvery = 32;
+
+// One leaderboard row
+struct ScoreEntry {
+    int score;        // Final score
+    string time;      // When it was recorded
+    string name;      // Player name
+};
+
+// Best rows and score counts of one leaderboard key
+struct BoardKey {
+    vector<ScoreEntry> top;   // best scores, highest first
+    vector<uint64_t> tree;    // Fenwick tree over score buckets (1-based)
+    uint64_t total;           // scores recorded under this key
+};
+
+// In-memory copy of the index file
+struct Leaderboard {
+    bool loaded;              // index file has been read
+    uint64_t watermark;       // history bytes folded into the keys
+    int pending;              // folded lines not yet written to the index
+    vector<string> ownAhead;  // our lines folded before the history has them
+    map<string, BoardKey> keys;
+    mutex lock;               // guards everything above
+
+    Leaderboard() : loaded(false), watermark(0), pending(0) {}
+};
+
+// The console uses defaultBoard; headless threads install their own
+Leaderboard defaultBoard;
+thread_local Leaderboard *activeBoard = &defaultBoard;
+
+// Returns the leaderboard key of a category and difficulty
+string boardKeySimple(const string &cat, char diff) {
+    return cat + "/" + string(1, diff);
+}
+
+// Maps a score to its 1-based bucket in the rank tree
+int scoreBucket(int score) {
+    if (score < SCORE_MIN) score = SCORE_MIN;
+    if (score > SCORE_MAX) score = SCORE_MAX;
+    return score - SCORE_MIN + 1;
+}
+
+// Adds n scores to bucket b of a key's rank tree
+void addScoreCount(BoardKey &k, int b, uint64_t n) {
+    if (k.tree.empty()) k.tree.assign(SCORE_BUCKETS + 1, 0);
+    for (int i = b; i <= SCORE_BUCKETS; i += i & -i) k.tree[i] += n;
+    k.total += n;
+}
+
+// Number of scores in buckets 1..b
+uint64_t countUpTo(const BoardKey &k, int b) {
+    uint64_t sum = 0;
+    if (k.tree.empty()) return 0;
+    for (int i = b; i > 0; i -= i & -i) sum += k.tree[i];
+    return sum;
+}
+
+// Inserts a score into a best-first list capped at MAX_HIGHS. Equal scores
+// keep the order they were recorded in.
+void insertTopScore(vector<ScoreEntry> &top, const ScoreEntry &e) {
+    if ((int)top.size() >= MAX_HIGHS && e.score <= top.back().score) return;
+    size_t lo = 0, hi = top.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (top[mid].score >= e.score) lo = mid + 1;
+        else hi = mid;
+    }
+    top.insert(top.begin() + lo, e);
+    if ((int)top.size() > MAX_HIGHS) top.pop_back();
+}
+
+// Records one score under a key
+void recordScoreUnder(const string &key, const ScoreEntry &e) {
+    Leaderboard &board = *activeBoard;
+    BoardKey &k = board.keys[key];
+    insertTopScore(k.top, e);
+    addScoreCount(k, scoreBucket(e.score), 1);
+}
+
+// Parses a history line; cat/diff are left empty for old 3-field lines.
+// Returns false if malformed.
+bool parseScoreLine(const string &line, ScoreEntry &e, string &cat, string &diff) {
+    size_t p[4];
+    int n = 0;
+    for (size_t at = line.find('|'); at != string::npos && n < 4; at = line.find('|', at + 1)) p[n++] = at;
+    if (n < 2) return false;
+    e.name = line.substr(0, p[0]);
+    e.score = atoi(line.substr(p[0] + 1, p[1] - p[0] - 1).c_str());
+    cat.clear();
+    diff.clear();
+    if (n < 4) {
+        e.time = line.substr(p[1] + 1);
+    } else {
+        e.time = line.substr(p[1] + 1, p[2] - p[1] - 1);
+        cat = line.substr(p[2] + 1, p[3] - p[2] - 1);
+        diff = line.substr(p[3] + 1);
+    }
+    return true;
+}
+
+// Reads the index file into board; a missing or bad file means "rebuild"
+void loadLeaderboardIndex() {
+    Leaderboard &board = *activeBoard;
+    board.loaded = true;
+    board.watermark = 0;
+    board.pending = 0;
+    board.ownAhead.clear();
+    board.keys.clear();
+
+    ifstream in(quizPaths().topScores.c_str());
+    string line;
+    if (!in.is_open() || !getline(in, line)) return;
+    unsigned long long mark = 0;
+    int version = 0;
+    if (sscanf(line.c_str(), "QTOP %d %llu", &version, &mark) != 2 || version != 1) return;
+
+    bool ok = true;
+    while (ok && getline(in, line)) {
+        if (line.compare(0, 2, "K ") != 0) { ok = false; break; }
+        size_t sp = line.find(' ', 2);
+        if (sp == string::npos) { ok = false; break; }
+        int rows = atoi(line.c_str() + 2);
+        BoardKey &k = board.keys[line.substr(sp + 1)];
+        for (int r = 0; r < rows && ok; r++) {
+            if (!getline(in, line)) { ok = false; break; }
+            size_t p1 = line.find('|');
+            size_t p2 = (p1 == string::npos) ? string::npos : line.find('|', p1 + 1);
+            if (p2 == string::npos) { ok = false; break; }
+            ScoreEntry e;
+            e.score = atoi(line.substr(0, p1).c_str());
+            e.time = line.substr(p1 + 1, p2 - p1 - 1);
+            e.name = line.substr(p2 + 1);
+            k.top.push_back(e);
+        }
+        if (!ok || !getline(in, line) || line.compare(0, 1, "F") != 0) { ok = false; break; }
+        const char *c = line.c_str() + 1;
+        int b;
+        unsigned long long n;
+        int used;
+        while (sscanf(c, " %d:%llu%n", &b, &n, &used) == 2) {
+            if (b < 1 || b > SCORE_BUCKETS) { ok = false; break; }
+            addScoreCount(k, b, n);
+            c += used;
+        }
+    }
+    if (!ok) {
+        board.keys.clear();
+        return;
+    }
+    board.watermark = mark;
+}
+
+// Formats board as the index file
+void formatLeaderboardIndex(ostream &out) {
+    Leaderboard &board = *activeBoard;
+    out << "QTOP 1 " << board.watermark << "\n";
+    for (map<string, BoardKey>::const_iterator it = board.keys.begin(); it != board.keys.end(); ++it) {
+        const BoardKey &k = it->second;
+        out << "K " << k.top.size() << " " << it->first << "\n";
+        for (size_t i = 0; i < k.top.size(); i++) {
+            out << k.top[i].score << "|" << k.top[i].time << "|" << k.top[i].name << "\n";
+        }
+        out << "F";
+        for (int b = 1; b <= SCORE_BUCKETS; b++) {
+            uint64_t n = countUpTo(k, b) - countUpTo(k, b - 1);
+            if (n > 0) out << " " << b << ":" << n;
+        }
+        out << "\n";
+    }
+}
+
+// Writes a formatted index to the index file (temporary file + rename)
+void writeLeaderboardFile(const string &text) {
+    string tmp = tempFileNameSimple(quizPaths().topScores);
+    ofstream out(tmp.c_str(), ios::trunc);
+    if (!out) return;
+    out << text;
+    out.close();
+    if (!out || rename(tmp.c_str(), quizPaths().topScores.c_str()) != 0) remove(tmp.c_str());
+}
+
+// Writes board to the index file. While some of our lines are folded but
+// not yet in the history the watermark would not cover them, so the write
+// waits (board.pending stays set) until they have been read back.
+void writeLeaderboardIndex() {
+    Leaderboard &board = *activeBoard;
+    if (!board.ownAhead.empty()) return;
+    ostringstream out;
+    formatLeaderboardIndex(out);
+    writeLeaderboardFile(out.str());
+    board.pending = 0;
+}
+
+// Folds history lines appended since the last call into the index. Only
+// complete lines past the watermark are read, and the watermark is always
+// an offset of a line end in the file; a history file that shrank
+// (replaced or truncated) triggers a full rebuild. Scores of this process
+// are folded when they are queued, so as they reach the file (in whatever
+// order, between other processes' lines) they are only struck off
+// board.ownAhead. With backgroundPersist only the syncer reads the history once the index
+// is loaded (see refreshLeaderboardSimple). Callers hold board.lock.
+void syncLeaderboard(bool fromSyncer = false) {
+    Leaderboard &board = *activeBoard;
+    if (!board.loaded) loadLeaderboardIndex();
+    else if (backgroundPersist && !fromSyncer) return;
+
+    uint64_t size;
+    int64_t mtime;
+    if (!statFileSimple(quizPaths().highScores, size, mtime)) size = 0;
+    if (size < board.watermark) {
+        board.watermark = 0;
+        board.ownAhead.clear();
+        board.keys.clear();
+    }
+    if (size == board.watermark) return;
+
+    ifstream in(quizPaths().highScores.c_str(), ios::binary);
+    if (!in.is_open()) return;
+    in.seekg((streamoff)board.watermark);
+    string line, cat, diff;
+    int folded = 0;
+    while (getline(in, line)) {
+        if (in.eof()) break; // partial last line: wait until it is complete
+        board.watermark += line.size() + 1;
+        vector<string>::iterator own = find(board.ownAhead.begin(), board.ownAhead.end(), line);
+        if (own != board.ownAhead.end()) { board.ownAhead.erase(own); continue; }
+        ScoreEntry e;
+        if (!parseScoreLine(line, e, cat, diff)) continue;
+        recordScoreUnder("", e);
+        if (!cat.empty() && diff.size() == 1) recordScoreUnder(boardKeySimple(cat, diff[0]), e);
+        folded++;
+    }
+    // a rebuild is always written; small increments are batched
+    board.pending += folded;
+    if (backgroundPersist) return;
+    if (board.pending >= boardPersistEvery || folded > boardPersistEvery) writeLeaderboardIndex();
+}
+
+// Background half of backgroundPersist for the leaderboard: folds lines
+// other processes appended and rewrites the index when scores are
+// pending, writing the file after board.lock is released
+void refreshLeaderboardSimple() {
+    Leaderboard &board = *activeBoard;
+    ostringstream out;
+    {
+        lock_guard<mutex> guard(board.lock);
+        syncLeaderboard(true);
+        if (board.pending == 0 || !board.ownAhead.empty()) return;
+        formatLeaderboardIndex(out);
+        board.pending = 0;
+    }
+    writeLeaderboardFile(out.str());
+}
+
+// Writes any unsaved index changes (called at exit)
+void closeLeaderboard() {
+    Leaderboard &board = *activeBoard;
+    lock_guard<mutex> guard(board.lock);
+    if (!board.loaded) return;
+    syncLeaderboard(true);
+    if (board.pending > 0) writeLeaderboardIndex();
+}
+
+// Saves a high score (queued to the async writer) and folds it straight
+// into the leaderboard index
+void saveHighScore(const string &name, int sc, const string &cat, char diff) {
+    ScopedStat timer(STAT_HIGH_SCORE);
+    Leaderboard &board = *activeBoard;
+    ScoreEntry e;
+    e.score = sc;
+    e.time = getTimeStringSimple();
+    e.name = name;
+    string line = name + "|" + to_string(sc) + "|" + e.time + "|" + cat + "|" + diff;
+
+    lock_guard<mutex> guard(board.lock);
+    syncLeaderboard();
+    board.ownAhead.push_back(line);
+    line += "\n";
+    asyncAppendLine(asyncTargetFor(quizPaths().highScores), line, true);
+    recordScoreUnder("", e);
+    recordScoreUnder(boardKeySimple(cat, diff), e);
+    board.pending++;
+    if (!backgroundPersist && board.pending >= boardPersistEvery) writeLeaderboardIndex();
+}
+
+// Rank of a score (1 = best) and the number of scores under a key ("" is
+// the overall board); ties share the better rank
+void scoreRankSimple(const string &key, int score, uint64_t &rank, uint64_t &total) {
+    Leaderboard &board = *activeBoard;
+    lock_guard<mutex> guard(board.lock);
+    syncLeaderboard();
+    map<string, BoardKey>::const_iterator it = board.keys.find(key);
+    if (it == board.keys.end()) { rank = 1; total = 0; return; }
+    total = it->second.total;
+    rank = 1 + (total - countUpTo(it->second, scoreBucket(score)));
+}
+
+// Copies the best n rows of a key ("" is the overall board)
+void topScoresFor(const string &key, int n, vector<ScoreEntry> &out) {
+    Leaderboard &board = *activeBoard;
+    lock_guard<mutex> guard(board.lock);
+    syncLeaderboard();
+    out.clear();
+    map<string, BoardKey>::const_iterator it = board.keys.find(key);
+    if (it == board.keys.end()) return;
+    for (int i = 0; i < n && i < (int)it->second.top.size(); i++) out.push_back(it->second.top[i]);
+}
+
+// Prints the player's rank after a finished session
+void showRankSimple(const string &cat, char diff, int score, ostream &out) {
+    uint64_t rank, total, grank, gtotal;
+    scoreRankSimple(boardKeySimple(cat, diff), score, rank, total);
+    scoreRankSimple("", score, grank, gtotal);
+    out << "Rank: #" << rank << " of " << total << " in " << cat << "/" << diff
+         << ", #" << grank << " of " << gtotal << " overall" << endl;
+}
+
+// Prints up to 5 rows of a leaderboard
+void printTopRows(const vector<ScoreEntry> &rows) {
+    for (size_t i = 0; i < rows.size(); i++) {
+        cout << (i + 1) << ") " << rows[i].name << " - " << rows[i].score << " (" << rows[i].time << ")" << endl;
+    }
+    if (rows.empty()) cout << "No scores yet." << endl;
+}
+
+// Displays top 5 high scores
+void showHighScoresSimple() {
+    vector<ScoreEntry> rows;
+    topScoresFor("", 5, rows);
+    printTopRows(rows);
+}
+
+// ---------- LOGGING ----------
+
+// Appends a simple log entry for each quiz run (through the async writer)
+void logQuizRun(const string &name, const string &cat, char d, int score, int c, int w) {
+    ScopedStat timer(STAT_LOG);
+    string line = getTimeStringSimple() + " | " + name + " | " + cat + " | " + d
+        + " | " + to_string(score) + " | correct:" + to_string(c) + " wrong:" + to_string(w) + "\n";
+    asyncAppendLine(asyncTargetFor(quizPaths().logs), line, false);
+}
+
+// ---------- SAVE / LOAD GAME ----------
+
+// Suspended sessions live in one store file (QuizPaths::saveStore): a header and
+// an open-addressing hash table of fixed 256-byte slots keyed by player
+// and category. The file is memory-mapped, so finding a save is one hash
+// probe and an update rewrites its slot in place; tens of thousands of
+// sessions fit in a few MB without a file per player.
+//
+// Each answered question also appends one small sealed record to the
+// journal (QuizPaths::journal), fsynced per journalSyncEvery. Opening the store
+// replays the journal onto the slots, and every journalCompactEvery
+// records the store is msynced and the journal truncated. With
+// backgroundPersist both happen on a timer in syncSaveStoreSimple, so
+// many answers share one fsync. A record torn
+// by a crash fails its FNV-1a seal and replay stops there. The slot
+// generation in each record keeps records of a finished session from
+// being applied to a new session that reused its slot. Several processes
+// may share a store: each operation holds an exclusive flock on
+// "<store>.lock", and a process whose mapping predates a grown (renamed)
+// store file maps the new one first.
+//   P|<slot>|<generation>|<index>|<score>|<correct>|<wrong>|<lifeline bits>|<streak>|<replaced + 1>|<hidden>|<extra ms>#<fnv1a-32 hex>
+
+const char SAVE_MAGIC[4] = { 'Q', 'S', 'A', 'V' };
+const uint32_t SAVE_VERSION = 1;
+const uint32_t SAVE_MIN_SLOTS = 1024;
+
+// fsync the journal after this many appended records (0 = leave it to the
+// OS). A small group shares one fsync among several answers; a crash loses
+// at most the answers of the last unfinished group.
+int journalSyncEvery = 8;
+
+// Apply the journal to the store and truncate it after this many records
+int journalCompactEvery = 64;
+
+// Slot states
+enum { SLOT_EMPTY = 0, SLOT_USED = 1, SLOT_DELETED = 2 };
+
+struct SaveStoreHeader {
+    char magic[4];       // "QSAV"
+    uint32_t version;    // SAVE_VERSION
+    uint32_t capacity;   // number of slots
+    uint32_t used;       // slots holding a session
+    uint32_t deleted;    // tombstones left by finished sessions
+    char pad[236];
+};
+
+struct SaveSlot {
+    uint32_t state;      // SLOT_EMPTY, SLOT_USED or SLOT_DELETED
+    uint32_t generation; // bumped each time the slot starts a session
+    uint64_t keyHash;    // hash of player and category
+    uint64_t seed;       // Random seed for shuffle
+    int32_t index;       // Current question index
+    int32_t score;       // Current score
+    int32_t correct;     // Number of correct answers
+    int32_t wrong;       // Number of wrong answers
+    uint8_t lifeBits;    // Lifeline usage state (see lifeBitsSimple), bit 4 = followUp
+    char diff;           // Difficulty
+    uint8_t streamed;    // Questions were sampled by streaming the file
+    uint8_t hidden;      // Options 50/50 removed from the current question
+    char player[128];    // Player name (NUL terminated, truncated)
+    char category[64];   // Category name (NUL terminated, truncated)
+    int32_t streak;      // Current run of correct answers
+    int32_t replaced;    // Replace position + 1, 0 if none
+    int32_t length;      // Questions drawn when the session started
+    int32_t extraMs;     // Answer time Extra Time added to the current question
+    char pad2[4];
+};
+
+static_assert(sizeof(SaveStoreHeader) == 256, "store header must be 256 bytes");
+static_assert(sizeof(SaveSlot) == 256, "store slot must be 256 bytes");
+
+// The open store and journal of this process
+struct SaveStore {
+    int fd;               // store file descriptor, -1 when closed
+    char *base;           // store mapping
+    size_t size;          // mapping length
+    SaveStoreHeader *hdr; // header at start of mapping
+    SaveSlot *slots;      // slot table after header
+    int jfd;              // journal append descriptor
+    int records;          // journal records since last compaction
+    int unsynced;         // journal records since last fsync
+    bool dirty;           // slots changed outside the journal since last msync
+    uint64_t inode;       // inode of the mapped store file
+    int lockFd;           // "<store>.lock", flocked for each operation; -1 until first use
+    mutex lock;           // guards everything above
+
+    SaveStore() : fd(-1), base(NULL), size(0), hdr(NULL), slots(NULL), jfd(-1), records(0), unsynced(0), dirty(false),
+                  inode(0), lockFd(-1) {}
+};
+
+// The console uses defaultStore; headless threads install their own
+SaveStore defaultStore;
+thread_local SaveStore *activeStore = &defaultStore;
+
+// Packs the four lifeline flags into bits 0..3
+int lifeBitsSimple(const LifeLines &life) {
+    return (life.used5050 ? 1 : 0) | (life.usedSkip ? 2 : 0) | (life.usedReplace ? 4 : 0) | (life.usedExtra ? 8 : 0);
+}
+
+// Unpacks lifeline flags packed by lifeBitsSimple
+LifeLines lifeFromBitsSimple(int bits) {
+    LifeLines life;
+    life.used5050 = (bits & 1) != 0;
+    life.usedSkip = (bits & 2) != 0;
+    life.usedReplace = (bits & 4) != 0;
+    life.usedExtra = (bits & 8) != 0;
+    return life;
+}
+
+// Copies a name into a fixed slot field, truncating if needed
+void copySlotName(char *dst, size_t cap, const string &src) {
+    size_t n = src.size() < cap - 1 ? src.size() : cap - 1;
+    memcpy(dst, src.data(), n);
+    memset(dst + n, 0, cap - n);
+}
+
+// Hash of a save key, computed on the names as a slot stores them
+uint64_t saveKeyHash(const string &player, const string &cat) {
+    SaveSlot tmp;
+    copySlotName(tmp.player, sizeof(tmp.player), player);
+    copySlotName(tmp.category, sizeof(tmp.category), cat);
+    uint64_t h = fnv1a64Simple(tmp.player, strlen(tmp.player));
+    h = fnv1a64Simple("|", 1, h);
+    return fnv1a64Simple(tmp.category, strlen(tmp.category), h);
+}
+
+// True if a used slot holds the given key
+bool slotMatches(const SaveSlot &sl, uint64_t h, const string &player, const string &cat) {
+    if (sl.state != SLOT_USED || sl.keyHash != h) return false;
+    SaveSlot tmp;
+    copySlotName(tmp.player, sizeof(tmp.player), player);
+    copySlotName(tmp.category, sizeof(tmp.category), cat);
+    return strcmp(sl.player, tmp.player) == 0 && strcmp(sl.category, tmp.category) == 0;
+}
+
+// Finds the slot of a key. With forInsert, returns the slot to write a
+// new session into (the first tombstone or empty slot on the probe path)
+// when the key is absent; otherwise returns -1 when absent.
+int findSlotSimple(const string &player, const string &cat, bool forInsert) {
+    SaveStore &store = *activeStore;
+    uint32_t cap = store.hdr->capacity;
+    uint64_t h = saveKeyHash(player, cat);
+    int firstFree = -1;
+    for (uint32_t n = 0; n < cap; n++) {
+        uint32_t i = (uint32_t)((h + n) % cap);
+        const SaveSlot &sl = store.slots[i];
+        if (sl.state == SLOT_EMPTY) {
+            if (firstFree < 0) firstFree = (int)i;
+            break;
+        }
+        if (sl.state == SLOT_DELETED) {
+            if (firstFree < 0) firstFree = (int)i;
+            continue;
+        }
+        if (slotMatches(sl, h, player, cat)) return (int)i;
+    }
+    return forInsert ? firstFree : -1;
+}
+
+// Flushes the bytes of one slot (or the header) to disk
+void syncSlotSimple(const void *p, size_t n) {
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)p & ~(uintptr_t)(page - 1);
+    msync((void *)start, (uintptr_t)p + n - start, MS_SYNC);
+}
+
+// Maps a store file read-write; returns false if missing or invalid
+bool mapStoreFile(const string &fname, SaveStore &st) {
+    st.fd = open(fname.c_str(), O_RDWR);
+    if (st.fd < 0) return false;
+    struct stat sb;
+    if (fstat(st.fd, &sb) != 0 || sb.st_size < (off_t)sizeof(SaveStoreHeader)) { close(st.fd); st.fd = -1; return false; }
+    st.inode = (uint64_t)sb.st_ino;
+    void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, st.fd, 0);
+    if (p == MAP_FAILED) { close(st.fd); st.fd = -1; return false; }
+    st.base = (char *)p;
+    st.size = (size_t)sb.st_size;
+    st.hdr = (SaveStoreHeader *)st.base;
+    st.slots = (SaveSlot *)(st.base + sizeof(SaveStoreHeader));
+    bool ok = memcmp(st.hdr->magic, SAVE_MAGIC, 4) == 0 && st.hdr->version == SAVE_VERSION
+        && st.hdr->capacity > 0
+        && sizeof(SaveStoreHeader) + (size_t)st.hdr->capacity * sizeof(SaveSlot) == st.size;
+    if (!ok) {
+        munmap(st.base, st.size);
+        close(st.fd);
+        st.fd = -1;
+        st.base = NULL;
+    }
+    return ok;
+}
+
+// Creates an empty store file with the given number of slots
+bool createStoreFile(const string &fname, uint32_t capacity) {
+    int fd = open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    SaveStoreHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SAVE_MAGIC, 4);
+    h.version = SAVE_VERSION;
+    h.capacity = capacity;
+    bool ok = writeAllSimple(fd, (const char *)&h, sizeof(h))
+        && ftruncate(fd, (off_t)(sizeof(h) + (size_t)capacity * sizeof(SaveSlot))) == 0
+        && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Unmaps the store
+void unmapStoreSimple() {
+    SaveStore &store = *activeStore;
+    if (store.base != NULL) munmap(store.base, store.size);
+    if (store.fd >= 0) close(store.fd);
+    store.base = NULL;
+    store.fd = -1;
+}
+
+// Makes the store durable and empties the journal. While the store is
+// open every record has already been written to its slot, so unlike
+// compactJournalSimple nothing is read back and no memory is allocated.
+void checkpointJournalSimple() {
+    SaveStore &store = *activeStore;
+    msync(store.base, store.size, MS_SYNC);
+    if (store.jfd >= 0 && ftruncate(store.jfd, 0) != 0) {
+        close(store.jfd);
+        store.jfd = open(quizPaths().journal.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    }
+    store.records = 0;
+    store.unsynced = 0;
+    store.dirty = false;
+}
+
+// Applies journal records to the store slots, makes the store durable and
+// truncates the journal
+void compactJournalSimple() {
+    SaveStore &store = *activeStore;
+    ifstream in(quizPaths().journal.c_str(), ios::binary);
+    string line;
+    while (in.is_open() && getline(in, line)) {
+        if (in.eof()) break; // last line has no newline: torn
+        if (line.size() < 10 || line[line.size() - 9] != '#') break;
+        uint32_t want = (uint32_t)strtoul(line.c_str() + line.size() - 8, NULL, 16);
+        line.resize(line.size() - 9);
+        if (fnv1aSimple(line.data(), line.size()) != want) break;
+
+        unsigned slot = 0, gen = 0;
+        int idx = 0, sc = 0, c = 0, w = 0, bits = 0, streak = 0, replaced = 0, hidden = 0, extraMs = 0;
+        int got = sscanf(line.c_str(), "P|%u|%u|%d|%d|%d|%d|%d|%d|%d|%d|%d", &slot, &gen, &idx, &sc, &c, &w, &bits,
+                         &streak, &replaced, &hidden, &extraMs);
+        if (got != 11) break;
+        if (slot >= store.hdr->capacity) continue;
+        SaveSlot &sl = store.slots[slot];
+        if (sl.state != SLOT_USED || sl.generation != gen) continue;
+        sl.index = idx;
+        sl.score = sc;
+        sl.correct = c;
+        sl.wrong = w;
+        sl.lifeBits = (uint8_t)bits;
+        sl.streak = streak;
+        sl.replaced = replaced;
+        sl.hidden = (uint8_t)hidden;
+        sl.extraMs = extraMs;
+    }
+    in.close();
+
+    msync(store.base, store.size, MS_SYNC);
+    if (store.jfd >= 0) close(store.jfd);
+    store.jfd = open(quizPaths().journal.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    store.records = 0;
+    store.unsynced = 0;
+}
+
+// Copies a session into a slot
+void fillSlotSimple(SaveSlot &sl, const SaveData &s) {
+    sl.seed = (uint64_t)s.seedValue;
+    sl.index = s.index;
+    sl.score = s.score;
+    sl.correct = s.correctCount;
+    sl.wrong = s.wrongCount;
+    sl.lifeBits = (uint8_t)(lifeBitsSimple(s.life) | (s.followUp ? 16 : 0));
+    sl.diff = s.diff;
+    sl.streamed = s.streamed ? 1 : 0;
+    sl.streak = s.streak;
+    sl.replaced = s.replaced + 1;
+    sl.length = s.length;
+    sl.hidden = (uint8_t)s.hidden;
+    sl.extraMs = s.extraMs;
+}
+
+// Copies a slot out into a session
+void readSlotSimple(const SaveSlot &sl, SaveData &s) {
+    s.playerName = sl.player;
+    s.categoryName = sl.category;
+    s.diff = sl.diff;
+    s.seedValue = (unsigned long)sl.seed;
+    s.streamed = sl.streamed != 0;
+    s.index = sl.index;
+    s.score = sl.score;
+    s.correctCount = sl.correct;
+    s.wrongCount = sl.wrong;
+    s.life = lifeFromBitsSimple(sl.lifeBits);
+    s.followUp = (sl.lifeBits & 16) != 0;
+    s.streak = sl.streak;
+    s.replaced = sl.replaced - 1;
+    s.length = sl.length;
+    s.hidden = sl.hidden;
+    s.extraMs = sl.extraMs;
+}
+
+// Rebuilds the store with more slots once tombstones and sessions fill
+// 70% of it, so probe chains stay short
+void growStoreIfNeeded() {
+    SaveStore &store = *activeStore;
+    uint32_t cap = store.hdr->capacity;
+    if ((uint64_t)(store.hdr->used + store.hdr->deleted + 1) * 10 <= (uint64_t)cap * 7) return;
+
+    // slot numbers change, so pending journal records must be applied first
+    compactJournalSimple();
+
+    uint32_t newCap = SAVE_MIN_SLOTS;
+    while ((uint64_t)(store.hdr->used + 1) * 10 > (uint64_t)newCap * 5) newCap *= 2;
+
+    string tmp = tempFileNameSimple(quizPaths().saveStore);
+    if (!createStoreFile(tmp, newCap)) return;
+    SaveStore grown;
+    if (!mapStoreFile(tmp, grown)) { remove(tmp.c_str()); return; }
+
+    for (uint32_t i = 0; i < cap; i++) {
+        const SaveSlot &sl = store.slots[i];
+        if (sl.state != SLOT_USED) continue;
+        uint32_t j = (uint32_t)(sl.keyHash % newCap);
+        while (grown.slots[j].state != SLOT_EMPTY) j = (j + 1) % newCap;
+        grown.slots[j] = sl;
+        grown.hdr->used++;
+    }
+    msync(grown.base, grown.size, MS_SYNC);
+
+    if (rename(tmp.c_str(), quizPaths().saveStore.c_str()) != 0) {
+        munmap(grown.base, grown.size);
+        close(grown.fd);
+        remove(tmp.c_str());
+        return;
+    }
+    unmapStoreSimple();
+    store.fd = grown.fd;
+    store.base = grown.base;
+    store.size = grown.size;
+    store.hdr = grown.hdr;
+    store.slots = grown.slots;
+    store.inode = grown.inode;
+}
+
+// Writes a session into its slot (creating the slot if needed)
+void putSessionSimple(const SaveData &s) {
+    SaveStore &store = *activeStore;
+    growStoreIfNeeded();
+    int i = findSlotSimple(s.playerName, s.categoryName, true);
+    if (i < 0) return;
+
+    SaveSlot &sl = store.slots[i];
+    if (sl.state != SLOT_USED) {
+        if (sl.state == SLOT_DELETED) store.hdr->deleted--;
+        store.hdr->used++;
+        sl.state = SLOT_USED;
+        sl.keyHash = saveKeyHash(s.playerName, s.categoryName);
+        copySlotName(sl.player, sizeof(sl.player), s.playerName);
+        copySlotName(sl.category, sizeof(sl.category), s.categoryName);
+    }
+    sl.generation++;
+    fillSlotSimple(sl, s);
+    store.dirty = true;
+    if (journalSyncEvery > 0) {
+        syncSlotSimple(&sl, sizeof(sl));
+        syncSlotSimple(store.hdr, sizeof(SaveStoreHeader));
+    }
+}
+
+// Loads a save written by older versions (one KEY:value line per field)
+bool loadLegacySaveSimple(SaveData &s) {
+    if (!fileExistsSimple(quizPaths().legacySave)) return false;
+    ifstream in(quizPaths().legacySave.c_str());
+    if (!in.is_open()) return false;
+    string line;
+    s.streamed = false;
+    s.streak = 0;
+    s.replaced = -1;
+    s.followUp = false;
+    s.hidden = 0;
+    s.extraMs = 0;
+    s.length = 10;
+    while (getline(in, line)) {
+        if (line.size() >= 7 && line.substr(0,7) == "PLAYER:") {
+            s.playerName = line.substr(7);
+        } else if (line.size() >= 4 && line.substr(0,4) == "CAT:") {
+            s.categoryName = line.substr(4);
+        } else if (line.size() >= 5 && line.substr(0,5) == "DIFF:") {
+            string v = line.substr(5);
+            if (v.length() > 0) s.diff = upchar(v[0]);
+        } else if (line.size() >= 5 && line.substr(0,5) == "SEED:") {
+            string v = line.substr(5);
+            s.seedValue = (unsigned long)atol(v.c_str());
+        } else if (line.size() >= 7 && line.substr(0,7) == "STREAM:") {
+            string v = line.substr(7);
+            s.streamed = (v == "1");
+        } else if (line.size() >= 6 && line.substr(0,6) == "INDEX:") {
+            string v = line.substr(6);
+            s.index = atoi(v.c_str());
+        } else if (line.size() >= 6 && line.substr(0,6) == "SCORE:") {
+            string v = line.substr(6);
+            s.score = atoi(v.c_str());
+        } else if (line.size() >= 8 && line.substr(0,8) == "CORRECT:") {
+            string v = line.substr(8);
+            s.correctCount = atoi(v.c_str());
+        } else if (line.size() >= 6 && line.substr(0,6) == "WRONG:") {
+            string v = line.substr(6);
+            s.wrongCount = atoi(v.c_str());
+        } else if (line.size() >= 5 && line.substr(0,5) == "5050:") {
+            string v = line.substr(5);
+            s.life.used5050 = (v == "1");
+        } else if (line.size() >= 5 && line.substr(0,5) == "SKIP:") {
+            string v = line.substr(5);
+            s.life.usedSkip = (v == "1");
+        } else if (line.size() >= 4 && line.substr(0,4) == "REP:") {
+            string v = line.substr(4);
+            s.life.usedReplace = (v == "1");
+        } else if (line.size() >= 6 && line.substr(0,6) == "EXTRA:") {
+            string v = line.substr(6);
+            s.life.usedExtra = (v == "1");
         }
-        else if (res == 2) {
-            // skip: just advance
-            i++;
+    }
+    in.close();
+    return true;
+}
+
+// Opens (creating if needed) the store and journal, replays the journal,
+// and imports a pre-store save file; returns false if unusable. An open
+// store is remapped if another process has grown it since. Callers hold
+// a StoreOp.
+bool openSaveStore() {
+    SaveStore &store = *activeStore;
+    if (store.base != NULL) {
+        struct stat sb;
+        if (stat(quizPaths().saveStore.c_str(), &sb) == 0 && (uint64_t)sb.st_ino == store.inode) return true;
+        unmapStoreSimple();
+    }
+    if (!mapStoreFile(quizPaths().saveStore, store)) {
+        if (fileExistsSimple(quizPaths().saveStore)) return false; // never clobber an unreadable store
+        if (!createStoreFile(quizPaths().saveStore, SAVE_MIN_SLOTS) || !mapStoreFile(quizPaths().saveStore, store)) return false;
+    }
+    compactJournalSimple();
+
+    SaveData old;
+    if (loadLegacySaveSimple(old)) {
+        putSessionSimple(old);
+        remove(quizPaths().legacySave.c_str());
+    }
+    return true;
+}
+
+// One store operation: holds store.lock against other threads and the
+// flock on "<store>.lock" against other processes, and makes sure the
+// store is open and current. ok is false if it is unusable.
+struct StoreOp {
+    lock_guard<mutex> guard;
+    bool locked;
+    bool ok;
+
+    StoreOp() : guard(activeStore->lock), locked(false), ok(false) {
+        SaveStore &store = *activeStore;
+        if (store.lockFd < 0) {
+            string lockName = quizPaths().saveStore + ".lock";
+            store.lockFd = open(lockName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (store.lockFd < 0) return;
+        }
+        int r;
+        while ((r = flock(store.lockFd, LOCK_EX)) != 0 && errno == EINTR) {}
+        if (r != 0) return;
+        locked = true;
+        ok = openSaveStore();
+    }
+    ~StoreOp() {
+        if (locked) flock(activeStore->lockFd, LOCK_UN);
+    }
+};
+
+// Applies the journal and closes the store (called at exit)
+void closeSaveStore() {
+    SaveStore &store = *activeStore;
+    bool open;
+    {
+        lock_guard<mutex> guard(store.lock);
+        open = store.base != NULL;
+    }
+    if (open) {
+        StoreOp op;
+        if (op.ok) {
+            compactJournalSimple();
+            if (store.jfd >= 0) close(store.jfd);
+            store.jfd = -1;
+            unmapStoreSimple();
+        }
+    }
+    lock_guard<mutex> guard(store.lock);
+    if (store.lockFd >= 0) close(store.lockFd);
+    store.lockFd = -1;
+}
+
+// Starts (or restarts) the saved session of s.playerName in s.categoryName.
+// Other players' and other categories' sessions are left untouched.
+void saveGameSimple(const SaveData &s) {
+    ScopedStat timer(STAT_SAVE_START);
+    StoreOp op;
+    if (!op.ok) return;
+    putSessionSimple(s);
+}
+
+// Records progress after each answer or lifeline: the slot is updated in
+// place and one small journal record is appended
+void appendSaveSimple(const SaveData &s) {
+    ScopedStat timer(STAT_SAVE_APPEND);
+    SaveStore &store = *activeStore;
+    StoreOp op;
+    if (!op.ok) return;
+    int i = findSlotSimple(s.playerName, s.categoryName, false);
+    if (i < 0 || store.jfd < 0) { putSessionSimple(s); return; }
+
+    SaveSlot &sl = store.slots[i];
+    fillSlotSimple(sl, s);
+
+    char buf[128];
+    int n = snprintf(buf, sizeof(buf), "P|%d|%u|%d|%d|%d|%d|%d|%d|%d|%d|%d", i, sl.generation, s.index, s.score,
+                     s.correctCount, s.wrongCount, (int)sl.lifeBits, sl.streak, sl.replaced, (int)sl.hidden, sl.extraMs);
+    n += snprintf(buf + n, sizeof(buf) - n, "#%08x\n", fnv1aSimple(buf, n));
+    if (!writeAllSimple(store.jfd, buf, n)) return;
+    store.records++;
+    store.unsynced++;
+
+    if (journalSyncEvery > 0 && store.unsynced >= journalSyncEvery) {
+        fsync(store.jfd);
+        store.unsynced = 0;
+    }
+    // in the background the syncer checkpoints; this only bounds the
+    // journal if it keeps missing a quiet moment
+    if (store.records >= (backgroundPersist ? 4 * journalCompactEvery : journalCompactEvery)) checkpointJournalSimple();
+}
+
+// Loads the saved session of a player in a category; returns false if none
+bool loadGameSimple(const string &player, const string &cat, SaveData &s) {
+    SaveStore &store = *activeStore;
+    StoreOp op;
+    if (!op.ok) return false;
+    int i = findSlotSimple(player, cat, false);
+    if (i < 0) return false;
+    readSlotSimple(store.slots[i], s);
+    return true;
+}
+
+// Every saved session of a player, by category name. One pass over the
+// slots, so saves of categories that left the catalog are found too.
+void listSavesSimple(const string &player, vector<SaveData> &out) {
+    SaveStore &store = *activeStore;
+    out.clear();
+    StoreOp op;
+    if (!op.ok) return;
+    SaveSlot key;
+    copySlotName(key.player, sizeof(key.player), player);
+    for (uint32_t i = 0; i < store.hdr->capacity; i++) {
+        const SaveSlot &sl = store.slots[i];
+        if (sl.state != SLOT_USED || strcmp(sl.player, key.player) != 0) continue;
+        SaveData s;
+        readSlotSimple(sl, s);
+        out.push_back(s);
+    }
+    sort(out.begin(), out.end(), [](const SaveData &a, const SaveData &b) { return a.categoryName < b.categoryName; });
+}
+
+// Removes the saved session of a player in a category (called when a quiz
+// completes); the slot becomes a tombstone
+void clearSaveSimple(const string &player, const string &cat) {
+    SaveStore &store = *activeStore;
+    StoreOp op;
+    if (!op.ok) return;
+    int i = findSlotSimple(player, cat, false);
+    if (i < 0) return;
+    store.slots[i].state = SLOT_DELETED;
+    store.hdr->used--;
+    store.hdr->deleted++;
+    store.dirty = true;
+    if (journalSyncEvery > 0) {
+        syncSlotSimple(&store.slots[i], sizeof(SaveSlot));
+        syncSlotSimple(store.hdr, sizeof(SaveStoreHeader));
+    }
+}
+
+// Background half of backgroundPersist, called on a timer: makes the
+// slots and journal records written since the last call durable with one
+// msync and one fsync, and once journalCompactEvery records have gathered
+// truncates the journal if no process appended to it meanwhile. The disk
+// work runs without store.lock or the flock (on a duplicate of the journal
+// descriptor), so sessions keep saving while it waits.
+void syncSaveStoreSimple() {
+    SaveStore &store = *activeStore;
+    char *base;
+    size_t size;
+    int jfd;
+    int records;
+    off_t journalBytes = -1;
+    {
+        lock_guard<mutex> guard(store.lock);
+        if (store.base == NULL || (store.unsynced == 0 && !store.dirty)) return;
+        base = store.base;
+        size = store.size;
+        jfd = store.jfd >= 0 ? dup(store.jfd) : -1;
+        records = store.records;
+        store.unsynced = 0;
+        store.dirty = false;
+        struct stat sb;
+        if (jfd >= 0 && fstat(jfd, &sb) == 0) journalBytes = sb.st_size;
+    }
+    bool ok = msync(base, size, MS_SYNC) == 0;
+    if (jfd >= 0) {
+        ok = fsync(jfd) == 0 && ok;
+        close(jfd);
+    }
+    if (ok && records < journalCompactEvery) return;
+    if (!ok) {
+        lock_guard<mutex> guard(store.lock);
+        store.dirty = true; // try again next time
+        return;
+    }
+    // records appended after the fstat above may describe slot writes
+    // the msync missed, so the journal is only emptied if it has not grown
+    StoreOp op;
+    struct stat sb;
+    if (!op.ok || store.base != base || store.jfd < 0 || fstat(store.jfd, &sb) != 0 || sb.st_size != journalBytes) return;
+    if (ftruncate(store.jfd, 0) != 0) {
+        close(store.jfd);
+        store.jfd = open(quizPaths().journal.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    }
+    store.records = 0;
+}
+
+// ---------- PENALTY and TIME HELPERS ----------
+
+// Returns penalty based on difficulty character
+int getPenaltySimple(char d) {
+    if (d == 'E') return penEasy;
+    if (d == 'M') return penMed;
+    return penHard;
+}
+
+// Returns time limit (seconds) based on difficulty
+int getTimeLimitSimple(char d) {
+    if (d == 'E') return timeEasy;
+    if (d == 'M') return timeMed;
+    return timeHard;
+}
+
+// ---------- ANSWER LATENCY ----------
+
+// How long players take to answer, per difficulty and per question, in
+// log-linear (HDR-style) histograms of milliseconds. Per difficulty each
+// power-of-two range is split into 16 equal buckets, so any value is
+// known to within about 6% from 1 ms up to about 17 minutes. Per question
+// the histogram is coarser and lives in the question statistics table
+// (see QUESTION STATISTICS), so it is lock-free and saved with the other
+// counts. This is the data for tuning timeEasy/timeMed/timeHard and for
+// finding slow questions.
+const int HDR_SUB_BITS = 4;
+const int HDR_SUB = 1 << HDR_SUB_BITS;
+const int HDR_MAX_POW = 20;                                  // 2^20 ms
+const int HDR_BUCKETS = (HDR_MAX_POW - HDR_SUB_BITS + 2) * HDR_SUB;
+
+// Updated with relaxed atomic adds, so answers never take a lock
+struct LatencyHist {
+    atomic<uint32_t> counts[HDR_BUCKETS];
+    atomic<uint64_t> total;
+    atomic<uint64_t> sumMs;
+    atomic<uint32_t> maxMs;
+};
+
+// Per question: under 0.5 s, then 4 buckets per power of two up to
+// 65.5 s (within about 12%), then everything slower
+const int QLAT_BUCKETS = 30;
+
+// Histogram bucket of a latency in ms
+int hdrBucketSimple(uint64_t ms) {
+    if (ms < (uint64_t)HDR_SUB) return (int)ms;
+    int k = 63 - __builtin_clzll(ms);
+    if (k > HDR_MAX_POW) return HDR_BUCKETS - 1;
+    int sub = (int)((ms >> (k - HDR_SUB_BITS)) & (HDR_SUB - 1));
+    return (k - HDR_SUB_BITS + 1) * HDR_SUB + sub;
+}
+
+// Highest latency in ms that falls into a bucket
+uint64_t hdrBucketTopSimple(int b) {
+    if (b < HDR_SUB) return (uint64_t)b;
+    int k = b / HDR_SUB + HDR_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(b % HDR_SUB);
+    return ((HDR_SUB + sub + 1) << (k - HDR_SUB_BITS)) - 1;
+}
+
+void hdrRecordSimple(LatencyHist &h, uint64_t ms) {
+    h.counts[hdrBucketSimple(ms)].fetch_add(1, memory_order_relaxed);
+    h.total.fetch_add(1, memory_order_relaxed);
+    h.sumMs.fetch_add(ms, memory_order_relaxed);
+    uint32_t v = (uint32_t)(ms < 0xFFFFFFFFu ? ms : 0xFFFFFFFFu);
+    uint32_t cur = h.maxMs.load(memory_order_relaxed);
+    while (v > cur && !h.maxMs.compare_exchange_weak(cur, v, memory_order_relaxed)) {}
+}
+
+// Latency in ms below which fraction p of the answers fall
+uint64_t hdrPercentileSimple(const LatencyHist &h, double p) {
+    uint64_t total = h.total.load(memory_order_relaxed);
+    uint64_t maxMs = h.maxMs.load(memory_order_relaxed);
+    if (total == 0) return 0;
+    uint64_t want = (uint64_t)(p * total + 0.5);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HDR_BUCKETS; b++) {
+        seen += h.counts[b].load(memory_order_relaxed);
+        if (seen >= want) return hdrBucketTopSimple(b) < maxMs ? hdrBucketTopSimple(b) : maxMs;
+    }
+    return maxMs;
+}
+
+// Per-question histogram bucket of a latency in ms
+int qlatBucketSimple(uint64_t ms) {
+    if (ms < 512) return 0;
+    int k = 63 - __builtin_clzll(ms);
+    if (k > 15) return QLAT_BUCKETS - 1;
+    return 1 + (k - 9) * 4 + (int)((ms >> (k - 2)) & 3);
+}
+
+// Highest latency in ms that falls into a per-question bucket (the last
+// one is open-ended and reported as 131 s)
+uint64_t qlatBucketTopSimple(int b) {
+    if (b == 0) return 511;
+    if (b >= QLAT_BUCKETS - 1) return 131071;
+    int k = 9 + (b - 1) / 4;
+    return ((uint64_t)(4 + (b - 1) % 4 + 1) << (k - 2)) - 1;
+}
+
+// Latency in ms below which fraction p of a question's answers fall;
+// total is the sum of its counts
+uint64_t qlatPercentileSimple(const atomic<uint32_t> counts[], uint64_t total, double p) {
+    if (total == 0) return 0;
+    uint64_t want = (uint64_t)(p * total + 0.5);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < QLAT_BUCKETS; b++) {
+        seen += counts[b].load(memory_order_relaxed);
+        if (seen >= want) return qlatBucketTopSimple(b);
+    }
+    return qlatBucketTopSimple(QLAT_BUCKETS - 1);
+}
+
+LatencyHist diffLatency[3];
+
+// Stable ID of a question: hash of its text and options, so it survives
+// reordering and rebuilding of the bank
+uint64_t questionIdSimple(const Question &q) {
+    uint64_t h = fnv1a64Simple(q.text.data(), q.text.size());
+    string_view opts[4] = { q.A, q.B, q.C, q.D };
+    for (int i = 0; i < 4; i++) {
+        h = fnv1a64Simple("\n", 1, h);
+        h = fnv1a64Simple(opts[i].data(), opts[i].size(), h);
+    }
+    return h;
+}
+
+// ---------- QUESTION STATISTICS ----------
+
+// Outcome counts of every question across all sessions, keyed by
+// questionIdSimple. The table is a fixed-size open-addressing hash whose
+// slots are claimed with one compare-and-swap and whose counters are
+// relaxed atomic adds, so concurrent sessions never take a lock. Once
+// questionStatsCapacity questions are tracked, new ones are only counted
+// in questionStatsDropped.
+//
+// Each slot also holds the question's answer latency histogram (see
+// ANSWER LATENCY).
+//
+// The table is loaded from questionStatsFile at startup and rewritten
+// (temp file + rename) with the stats file and at exit. Each record is
+// a fixed 176 bytes:
+//   header : "QSTS", version, record count, reserved (4 x uint32)
+//   record : id (uint64), counts[QSTAT_COUNT] (uint32), pad, answer ms sum (uint64),
+//            latency[QLAT_BUCKETS] (uint32)
+enum QuestionStat { QSTAT_SHOWN, QSTAT_CORRECT, QSTAT_WRONG, QSTAT_TIMEOUT, QSTAT_NO_ANSWER,
+                    QSTAT_SKIP, QSTAT_REPLACE, QSTAT_5050, QSTAT_EXTRA, QSTAT_COUNT };
+
+const char QSTATS_MAGIC[4] = { 'Q', 'S', 'T', 'S' };
+const uint32_t QSTATS_VERSION = 1;
+
+struct QuestionStatSlot {
+    atomic<uint64_t> id;                  // 0 while the slot is free
+    atomic<uint32_t> counts[QSTAT_COUNT];
+    atomic<uint64_t> answerMs;            // sum of answer times of correct/wrong answers
+    atomic<uint32_t> latency[QLAT_BUCKETS]; // answer times (see ANSWER LATENCY)
+};
+
+struct QuestionStatRecord {
+    uint64_t id;
+    uint32_t counts[QSTAT_COUNT];
+    uint32_t pad;
+    uint64_t answerMs;
+    uint32_t latency[QLAT_BUCKETS];
+};
+
+static_assert(sizeof(QuestionStatRecord) == 176, "question stat record must be 176 bytes");
+
+unique_ptr<QuestionStatSlot[]> questionStats;
+once_flag questionStatsInit;
+atomic<uint64_t> questionStatsDropped(0);
+
+// Allocates the table on first use
+void initQuestionStats() {
+    call_once(questionStatsInit, []() {
+        questionStats.reset(new QuestionStatSlot[questionStatsCapacity]);
+        for (uint32_t i = 0; i < questionStatsCapacity; i++) {
+            questionStats[i].id.store(0, memory_order_relaxed);
+            for (int c = 0; c < QSTAT_COUNT; c++) questionStats[i].counts[c].store(0, memory_order_relaxed);
+            questionStats[i].answerMs.store(0, memory_order_relaxed);
+            for (int b = 0; b < QLAT_BUCKETS; b++) questionStats[i].latency[b].store(0, memory_order_relaxed);
+        }
+    });
+}
+
+// Finds the slot of a question, claiming a free one when create is set;
+// NULL if absent (or the table is full)
+QuestionStatSlot *questionStatSlot(uint64_t id, bool create) {
+    initQuestionStats();
+    if (id == 0) id = 1; // 0 marks free slots
+    uint32_t mask = questionStatsCapacity - 1;
+    for (uint32_t n = 0, i = (uint32_t)id & mask; n < questionStatsCapacity; n++, i = (i + 1) & mask) {
+        QuestionStatSlot &sl = questionStats[i];
+        uint64_t cur = sl.id.load(memory_order_acquire);
+        if (cur == id) return &sl;
+        if (cur != 0) continue;
+        if (!create) return NULL;
+        if (sl.id.compare_exchange_strong(cur, id, memory_order_acq_rel)) return &sl;
+        if (cur == id) return &sl; // another thread claimed it for the same question
+    }
+    return NULL;
+}
+
+// Counts one event for question q
+void countQuestionStat(const Question &q, QuestionStat what, uint64_t answerMs = 0) {
+    if (!statsEnabled) return;
+    QuestionStatSlot *sl = questionStatSlot(questionIdSimple(q), true);
+    if (!sl) { questionStatsDropped.fetch_add(1, memory_order_relaxed); return; }
+    sl->counts[what].fetch_add(1, memory_order_relaxed);
+    if (answerMs) sl->answerMs.fetch_add(answerMs, memory_order_relaxed);
+}
+
+// Adds the records of the stats file to the table; false if unreadable
+bool loadQuestionStats(const string &path) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in.is_open()) return false;
+    uint32_t hdr[4];
+    if (!in.read((char *)hdr, sizeof(hdr)) || memcmp(hdr, QSTATS_MAGIC, 4) != 0) return false;
+    if (hdr[1] != QSTATS_VERSION) return false;
+    QuestionStatRecord r;
+    for (uint32_t i = 0; i < hdr[2] && in.read((char *)&r, sizeof(r)); i++) {
+        QuestionStatSlot *sl = questionStatSlot(r.id, true);
+        if (!sl) { questionStatsDropped.fetch_add(1, memory_order_relaxed); continue; }
+        for (int c = 0; c < QSTAT_COUNT; c++) sl->counts[c].fetch_add(r.counts[c], memory_order_relaxed);
+        sl->answerMs.fetch_add(r.answerMs, memory_order_relaxed);
+        for (int b = 0; b < QLAT_BUCKETS; b++) sl->latency[b].fetch_add(r.latency[b], memory_order_relaxed);
+    }
+    return true;
+}
+
+// Writes every tracked question to the stats file
+bool saveQuestionStats(const string &path) {
+    if (!questionStats) return true; // nothing recorded or loaded
+    vector<QuestionStatRecord> recs;
+    for (uint32_t i = 0; i < questionStatsCapacity; i++) {
+        const QuestionStatSlot &sl = questionStats[i];
+        uint64_t id = sl.id.load(memory_order_acquire);
+        if (id == 0) continue;
+        QuestionStatRecord r;
+        r.id = id;
+        for (int c = 0; c < QSTAT_COUNT; c++) r.counts[c] = sl.counts[c].load(memory_order_relaxed);
+        r.pad = 0;
+        r.answerMs = sl.answerMs.load(memory_order_relaxed);
+        for (int b = 0; b < QLAT_BUCKETS; b++) r.latency[b] = sl.latency[b].load(memory_order_relaxed);
+        recs.push_back(r);
+    }
+    string tmp = tempFileNameSimple(path);
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    uint32_t hdr[4];
+    memcpy(hdr, QSTATS_MAGIC, 4);
+    hdr[1] = QSTATS_VERSION;
+    hdr[2] = (uint32_t)recs.size();
+    hdr[3] = 0;
+    bool ok = writeAllSimple(fd, (const char *)hdr, sizeof(hdr))
+        && writeAllSimple(fd, (const char *)recs.data(), recs.size() * sizeof(QuestionStatRecord));
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) { remove(tmp.c_str()); return false; }
+    return true;
+}
+
+// Prints the hardest questions of the given categories (lowest correct
+// rate among those shown at least minShown times)
+void printQuestionStatsSimple(ostream &out, const vector<string> &cats, int minShown, int limit) {
+    struct Row { double correctRate; const QuestionStatSlot *sl; string cat; string text; };
+    vector<Row> rows;
+    uint64_t tracked = 0;
+    for (size_t c = 0; c < cats.size(); c++) {
+        shared_ptr<const QuestionBank> bank = getQuestionBank(cats[c]);
+        for (uint32_t pos = 0; pos < bank->count; pos++) {
+            Question q = bankQuestion(*bank, pos);
+            const QuestionStatSlot *sl = questionStatSlot(questionIdSimple(q), false);
+            if (!sl) continue;
+            tracked++;
+            uint32_t shown = sl->counts[QSTAT_SHOWN].load(memory_order_relaxed);
+            if (shown < (uint32_t)minShown) continue;
+            Row r;
+            r.correctRate = (double)sl->counts[QSTAT_CORRECT].load(memory_order_relaxed) / shown;
+            r.sl = sl;
+            r.cat = cats[c];
+            r.text = string(q.text.substr(0, 40));
+            rows.push_back(r);
+        }
+    }
+    out << "Questions with stats: " << tracked;
+    if (questionStatsDropped.load() > 0) out << " (" << questionStatsDropped.load() << " events dropped, table full)";
+    out << endl;
+    if (rows.empty()) return;
+    sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.correctRate < b.correctRate; });
+
+    char line[240];
+    snprintf(line, sizeof(line), "%6s %6s %6s %6s %6s %8s  %s", "shown", "right", "t/out", "life", "skip", "mean s", "question");
+    out << line << endl;
+    for (size_t i = 0; i < rows.size() && (int)i < limit; i++) {
+        const QuestionStatSlot &sl = *rows[i].sl;
+        uint32_t shown = sl.counts[QSTAT_SHOWN].load(memory_order_relaxed);
+        uint32_t answered = sl.counts[QSTAT_CORRECT].load(memory_order_relaxed) + sl.counts[QSTAT_WRONG].load(memory_order_relaxed);
+        uint32_t lifelines = sl.counts[QSTAT_SKIP].load(memory_order_relaxed) + sl.counts[QSTAT_REPLACE].load(memory_order_relaxed)
+            + sl.counts[QSTAT_5050].load(memory_order_relaxed) + sl.counts[QSTAT_EXTRA].load(memory_order_relaxed);
+        snprintf(line, sizeof(line), "%6u %5.0f%% %5.0f%% %5.0f%% %5.0f%% %8.2f  %s: %s", shown, 100.0 * rows[i].correctRate,
+                 100.0 * sl.counts[QSTAT_TIMEOUT].load(memory_order_relaxed) / shown, 100.0 * lifelines / shown,
+                 100.0 * sl.counts[QSTAT_SKIP].load(memory_order_relaxed) / shown,
+                 answered ? sl.answerMs.load(memory_order_relaxed) / 1000.0 / answered : 0.0,
+                 rows[i].cat.c_str(), rows[i].text.c_str());
+        out << line << endl;
+    }
+}
+
+// Records how long an answer to q took, in its difficulty's histogram
+// and in its slot of the question statistics table
+void recordAnswerLatency(const Question &q, uint64_t ms) {
+    if (!statsEnabled) return;
+    int slot = diffSlot(q.diff);
+    if (slot >= 0) hdrRecordSimple(diffLatency[slot], ms);
+    QuestionStatSlot *sl = questionStatSlot(questionIdSimple(q), true);
+    if (!sl) { questionStatsDropped.fetch_add(1, memory_order_relaxed); return; }
+    sl->latency[qlatBucketSimple(ms)].fetch_add(1, memory_order_relaxed);
+}
+
+// Prints answer latency per difficulty against its limit, and the
+// questions of the given categories that take longest (by p90, with at
+// least minAnswers answers)
+void printLatencySimple(ostream &out, const vector<string> &cats, int minAnswers) {
+    const char diffs[3] = { 'E', 'M', 'H' };
+    char line[200];
+    snprintf(line, sizeof(line), "%-10s %8s %9s %9s %9s %9s %7s", "answers", "count", "p50 s", "p90 s", "p99 s", "max s", "limit");
+    out << line << endl;
+    for (int d = 0; d < 3; d++) {
+        const LatencyHist &h = diffLatency[d];
+        snprintf(line, sizeof(line), "%-10c %8llu %9.2f %9.2f %9.2f %9.2f %6ds", diffs[d], (unsigned long long)h.total.load(),
+                 hdrPercentileSimple(h, 0.50) / 1000.0, hdrPercentileSimple(h, 0.90) / 1000.0,
+                 hdrPercentileSimple(h, 0.99) / 1000.0, h.maxMs.load() / 1000.0, getTimeLimitSimple(diffs[d]));
+        out << line << endl;
+    }
+
+    struct Row { uint64_t p90; uint64_t answers; char diff; string cat; string text; };
+    vector<Row> slow;
+    for (size_t c = 0; c < cats.size(); c++) {
+        shared_ptr<const QuestionBank> bank = getQuestionBank(cats[c]);
+        for (uint32_t pos = 0; pos < bank->count; pos++) {
+            Question q = bankQuestion(*bank, pos);
+            const QuestionStatSlot *sl = questionStatSlot(questionIdSimple(q), false);
+            if (!sl) continue;
+            uint64_t answers = 0;
+            for (int b = 0; b < QLAT_BUCKETS; b++) answers += sl->latency[b].load(memory_order_relaxed);
+            if (answers == 0 || answers < (uint64_t)minAnswers) continue;
+            Row r = { qlatPercentileSimple(sl->latency, answers, 0.90), answers, q.diff, cats[c], string(q.text.substr(0, 48)) };
+            slow.push_back(r);
+        }
+    }
+    sort(slow.begin(), slow.end(), [](const Row &a, const Row &b) { return a.p90 > b.p90; });
+    if (slow.empty()) return;
+    out << "Slowest questions (p90):" << endl;
+    for (size_t i = 0; i < slow.size() && i < 5; i++) {
+        snprintf(line, sizeof(line), "%7.2fs  %s/%c  %llu answers  %s", slow[i].p90 / 1000.0, slow[i].cat.c_str(), slow[i].diff,
+                 (unsigned long long)slow[i].answers, slow[i].text.c_str());
+        out << line << endl;
+    }
+}
+
+// ---------- STATS FILE ----------
+
+// Writes all stats in the Prometheus text format (via a temp file and a
+// rename, so a scraper never sees half a file)
+bool writeStatsFileSimple(const string &path) {
+    StatsSnapshot snap;
+    snapshotStatsSimple(snap);
+    string tmp = tempFileNameSimple(path);
+    ofstream out(tmp.c_str());
+    if (!out) return false;
+    out << "# HELP quiz_op_seconds Time spent in quiz operations." << endl;
+    out << "# TYPE quiz_op_seconds histogram" << endl;
+    for (int s = 0; s < STAT_COUNT; s++) {
+        // every other power of two from ~1us to ~17s keeps the file short
+        uint64_t cum = 0;
+        int b = 0;
+        for (int le = 10; le <= 34; le += 2) {
+            for (; b < le; b++) cum += snap.buckets[s][b];
+            out << "quiz_op_seconds_bucket{op=\"" << statNames[s] << "\",le=\"" << ((uint64_t)1 << le) / 1e9 << "\"} " << cum << "\n";
+        }
+        out << "quiz_op_seconds_bucket{op=\"" << statNames[s] << "\",le=\"+Inf\"} " << snap.count[s] << "\n";
+        out << "quiz_op_seconds_sum{op=\"" << statNames[s] << "\"} " << snap.sumNs[s] / 1e9 << "\n";
+        out << "quiz_op_seconds_count{op=\"" << statNames[s] << "\"} " << snap.count[s] << "\n";
+    }
+    {
+        const char diffs[3] = { 'E', 'M', 'H' };
+        out << "# HELP quiz_answer_seconds Time taken to answer a question." << endl;
+        out << "# TYPE quiz_answer_seconds histogram" << endl;
+        for (int d = 0; d < 3; d++) {
+            // one line per power of two from 1 s to 2^10 s
+            const LatencyHist &h = diffLatency[d];
+            uint64_t cum = 0;
+            int b = 0;
+            for (int le = 0; le <= 10; le++) {
+                uint64_t top = ((uint64_t)1000 << le);
+                for (; b < HDR_BUCKETS && hdrBucketTopSimple(b) < top; b++) cum += h.counts[b].load(memory_order_relaxed);
+                out << "quiz_answer_seconds_bucket{diff=\"" << diffs[d] << "\",le=\"" << (1 << le) << "\"} " << cum << "\n";
+            }
+            out << "quiz_answer_seconds_bucket{diff=\"" << diffs[d] << "\",le=\"+Inf\"} " << h.total.load() << "\n";
+            out << "quiz_answer_seconds_sum{diff=\"" << diffs[d] << "\"} " << h.sumMs.load() / 1000.0 << "\n";
+            out << "quiz_answer_seconds_count{diff=\"" << diffs[d] << "\"} " << h.total.load() << "\n";
+        }
+    }
+    out << "# HELP quiz_events_total Quiz events since start." << endl;
+    out << "# TYPE quiz_events_total counter" << endl;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << "quiz_events_total{event=\"" << counterNames[c] << "\"} " << snap.counters[c] << "\n";
+    }
+    out.close();
+    if (!out) { remove(tmp.c_str()); return false; }
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+atomic<int64_t> statsFileWrittenAt(0);
+
+// Rewrites the stats file when statsFileEvery seconds have passed since
+// the last write; cheap enough to call after every session. With
+// backgroundPersist only the syncer writes it.
+void maybeWriteStatsFile(bool fromSyncer = false) {
+    if (!statsEnabled || statsFileEvery <= 0 || (backgroundPersist && !fromSyncer)) return;
+    int64_t now = (int64_t)time(NULL);
+    int64_t last = statsFileWrittenAt.load();
+    if (now - last < statsFileEvery) return;
+    if (!statsFileWrittenAt.compare_exchange_strong(last, now)) return; // another thread is writing
+    writeStatsFileSimple(statsFile);
+    saveQuestionStats(questionStatsFile);
+}
+
+// ---------- SESSION STATE MACHINE ----------
+
+// Every session (console, resumed, headless or served) runs on this
+// machine. It is driven one input line at a time and never blocks, so one
+// thread can run many sessions. Between inputs its whole state is the
+// SaveData it journals; the bank and play order are rebuilt from the
+// category, seed and replace position, so resuming a save is just
+// sessionRestoreSimple followed by more input.
+enum SessionState { SESSION_ANSWER, SESSION_FOLLOWUP, SESSION_DONE };
+
+// Phases of a session whose wall time can be recorded
+enum SessionPhase { PHASE_LOAD, PHASE_SHUFFLE, PHASE_ASK, PHASE_SAVE, PHASE_SCORE, PHASE_LOG, PHASE_COUNT };
+const char *phaseNames[PHASE_COUNT] = { "load", "shuffle", "ask", "save", "score", "log" };
+
+// Per-session phase times in microseconds
+struct SessionTimings {
+    double us[PHASE_COUNT];
+    int questions;
+};
+
+// Bank positions still to be played, held in a ring: the current question
+// is at 'head', answering pops it and Replace moves it behind the last
+// one, both in O(1). The slots are sized once when the session loads, with
+// one spare for the single Replace, so answering never allocates.
+struct PlayQueue {
+    vector<uint32_t> slots;   // ring storage
+    uint32_t head;            // slot of the current question
+    uint32_t size;            // questions left, current included
+};
+
+// Bank position of the current question
+uint32_t queueFrontSimple(const PlayQueue &q) {
+    return q.slots[q.head];
+}
+
+// Drops the current question
+void queuePopSimple(PlayQueue &q) {
+    q.head = (q.head + 1) % (uint32_t)q.slots.size();
+    q.size--;
+}
+
+// Moves the current question behind the last one (needs a free slot)
+void queueRotateSimple(PlayQueue &q) {
+    uint32_t cap = (uint32_t)q.slots.size();
+    q.slots[(q.head + q.size) % cap] = q.slots[q.head];
+    q.head = (q.head + 1) % cap;
+}
+
+struct QuizSession {
+    SessionState state;
+    SaveData sd;                          // everything needed to resume
+    shared_ptr<const QuestionBank> bank;
+    PlayQueue queue;                      // bank positions left to play
+    int totalQ;
+    chrono::steady_clock::time_point askedAt; // when the current question was shown
+    int64_t limitMs;                      // answer deadline, relative to askedAt
+    SessionTimings *timings;              // optional phase times
+};
+
+// Microseconds elapsed since t0
+double elapsedUsSimple(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+}
+
+// Adds the time since t0 to a phase when the session records timings
+void sessionTimeSimple(QuizSession &s, SessionPhase p, chrono::steady_clock::time_point t0) {
+    if (s.timings) s.timings->us[p] += elapsedUsSimple(t0);
+}
+
+// Milliseconds since the current question was shown (monotonic clock)
+int64_t sessionElapsedMs(const QuizSession &s) {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - s.askedAt).count();
+}
+
+// Milliseconds left before the current question times out (0 if past)
+int64_t sessionRemainingMs(const QuizSession &s) {
+    int64_t left = s.limitMs - sessionElapsedMs(s);
+    return left > 0 ? left : 0;
+}
+
+// Monotonic time in ms at which the current question times out
+int64_t sessionDeadlineMs(const QuizSession &s) {
+    return chrono::duration_cast<chrono::milliseconds>(s.askedAt.time_since_epoch()).count() + s.limitMs;
+}
+
+// The question being asked
+Question sessionQuestionSimple(const QuizSession &s) {
+    return bankQuestion(*s.bank, queueFrontSimple(s.queue));
+}
+
+// Records the session state in the save store and journal
+void sessionSaveSimple(QuizSession &s) {
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    appendSaveSimple(s.sd);
+    sessionTimeSimple(s, PHASE_SAVE, t0);
+}
+
+// Shows the current question and the lifelines still available
+void sessionPromptSimple(QuizSession &s, ostream &out) {
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    Question q = sessionQuestionSimple(s);
+    const LifeLines &life = s.sd.life;
+    out << endl << "Question " << (s.sd.index + 1) << " of " << s.totalQ << endl;
+    out << "Q: " << q.text << endl;
+    string_view opts[4] = { q.A, q.B, q.C, q.D };
+    for (int k = 0; k < 4; k++) {
+        if (!(s.sd.hidden & (1 << k))) out << (char)('A' + k) << ") " << opts[k] << endl;
+    }
+    if (s.sd.followUp) {
+        // restored while waiting for the answer after a lifeline, whose
+        // hidden options and extra time still apply
+        out << "Enter answer (A-D): ";
+        s.state = SESSION_FOLLOWUP;
+    } else {
+        out << "Lifelines: ";
+        if (!life.used5050) out << "[1]50/50 ";
+        if (!life.usedSkip) out << "[2]Skip ";
+        if (!life.usedReplace) out << "[3]Replace ";
+        if (!life.usedExtra) out << "[4]ExtraTime ";
+        out << endl;
+        out << "Enter answer letter (A-D) or lifeline number: ";
+        s.state = SESSION_ANSWER;
+    }
+    s.askedAt = chrono::steady_clock::now();
+    s.limitMs = (int64_t)getTimeLimitSimple(q.diff) * 1000 + s.sd.extraMs;
+    countQuestionStat(q, QSTAT_SHOWN);
+    if (s.timings) s.timings->questions++;
+    sessionTimeSimple(s, PHASE_ASK, t0);
+}
+
+// Opens the bank of s.sd and rebuilds the play queue from its seed, then
+// replays a restored save's progress onto it. Returns false when there is
+// nothing to play.
+bool sessionLoadSimple(QuizSession &s, ostream &out) {
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    s.bank = openSessionBank(s.sd.categoryName, s.sd.seedValue, s.sd.streamed, s.sd.length);
+    sessionTimeSimple(s, PHASE_LOAD, t0);
+    if (s.bank->count == 0) {
+        out << "No questions found for this category." << endl;
+        return false;
+    }
+
+    // positions of the chosen difficulty come from the bank index
+    t0 = chrono::steady_clock::now();
+    DiffIndex idx = bankDiffIndex(*s.bank, s.sd.diff);
+    if (idx.count == 0) {
+        out << "No questions with selected difficulty." << endl;
+        return false;
+    }
+    QuizRng rng = makeRngSimple(s.sd.seedValue);
+    PlayQueue &pq = s.queue;
+    pq.slots.reserve((size_t)s.sd.length + 1);
+    simpleShuffle(idx.pos, idx.count, (uint32_t)s.sd.length, rng, pq.slots);
+    pq.head = 0;
+    pq.size = (uint32_t)pq.slots.size();
+    pq.slots.push_back(0); // spare slot for Replace
+    s.totalQ = (int)pq.size;
+
+    // questions before the saved index were answered, and Replace sent
+    // the one at its position to the back
+    for (int k = 0; k <= s.sd.index && pq.size > 0; k++) {
+        if (k == s.sd.replaced) queueRotateSimple(pq);
+        if (k < s.sd.index) queuePopSimple(pq);
+    }
+    sessionTimeSimple(s, PHASE_SHUFFLE, t0);
+    return true;
+}
+
+// Reports the result, saves the high score, logs, and clears the save
+void sessionFinishSimple(QuizSession &s, ostream &out) {
+    SaveData &sd = s.sd;
+    out << endl << "Final Score: " << sd.score << endl;
+    out << "Correct: " << sd.correctCount << "  Wrong: " << sd.wrongCount << endl;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    saveHighScore(sd.playerName, sd.score, sd.categoryName, sd.diff);
+    showRankSimple(sd.categoryName, sd.diff, sd.score, out);
+    sessionTimeSimple(s, PHASE_SCORE, t0);
+
+    t0 = chrono::steady_clock::now();
+    logQuizRun(sd.playerName, sd.categoryName, sd.diff, sd.score, sd.correctCount, sd.wrongCount);
+    sessionTimeSimple(s, PHASE_LOG, t0);
+
+    t0 = chrono::steady_clock::now();
+    clearSaveSimple(sd.playerName, sd.categoryName);
+    sessionTimeSimple(s, PHASE_SAVE, t0);
+
+    out << "Quiz completed." << endl;
+    s.state = SESSION_DONE;
+    countStatSimple(COUNT_FINISHED);
+    maybeWriteStatsFile();
+}
+
+// Starts a new session: draws the play order, saves the start and shows
+// the first question. Returns false when there is nothing to play.
+bool sessionStartSimple(QuizSession &s, const string &player, const string &cat, char diff,
+                        uint64_t seedVal, ostream &out) {
+    s.state = SESSION_DONE;
+    s.sd.playerName = player;
+    s.sd.categoryName = cat;
+    s.sd.diff = diff;
+    s.sd.seedValue = seedVal;
+    s.sd.streamed = useStreamSampling(cat);
+    s.sd.index = 0;
+    s.sd.score = 0;
+    s.sd.correctCount = 0;
+    s.sd.wrongCount = 0;
+    s.sd.life.used5050 = false;
+    s.sd.life.usedSkip = false;
+    s.sd.life.usedReplace = false;
+    s.sd.life.usedExtra = false;
+    s.sd.streak = 0;
+    s.sd.replaced = -1;
+    s.sd.followUp = false;
+    s.sd.hidden = 0;
+    s.sd.extraMs = 0;
+    s.sd.length = playLength;
+    if (!sessionLoadSimple(s, out)) return false;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    saveGameSimple(s.sd);
+    sessionTimeSimple(s, PHASE_SAVE, t0);
+    countStatSimple(COUNT_SESSIONS);
+    sessionPromptSimple(s, out);
+    return true;
+}
+
+// Continues a saved session where it stopped. Returns false when its
+// questions are gone.
+bool sessionRestoreSimple(QuizSession &s, const SaveData &sd, ostream &out) {
+    s.state = SESSION_DONE;
+    s.sd = sd;
+    if (!sessionLoadSimple(s, out)) return false;
+    if (s.sd.index >= s.totalQ) sessionFinishSimple(s, out);
+    else sessionPromptSimple(s, out);
+    return true;
+}
+
+// Applies a question result, records the progress, then shows the next
+// question or finishes the session. Codes:
+// 1 => correct, 0 => wrong, -1 => timeout, 2 => skip, 3 => replace, 4 => invalid/no answer
+void sessionAdvanceSimple(QuizSession &s, int res, ostream &out) {
+    SaveData &sd = s.sd;
+    sd.followUp = false;
+    sd.hidden = 0;
+    sd.extraMs = 0;
+    countStatSimple(COUNT_ANSWERS);
+    if (res == 1) {
+        sd.score++;
+        sd.correctCount++;
+        if (sd.streak == 3) { sd.score += 5; out << "Streak +5!" << endl; }
+        if (sd.streak == 5) { sd.score += 15; out << "Streak +15!" << endl; }
+        sd.index++;
+    } else if (res == 0 || res == -1) {
+        sd.score -= getPenaltySimple(sd.diff);
+        sd.wrongCount++;
+        sd.index++;
+    } else if (res == 3) {
+        // replace: send this question to the back of the queue (the
+        // session keeps its length; it is asked again last)
+        sd.replaced = sd.index;
+        queueRotateSimple(s.queue);
+    } else {
+        // skip, invalid or no answer: move on without penalty
+        sd.index++;
+    }
+    if (res != 3) queuePopSimple(s.queue);
+    sessionSaveSimple(s);
+
+    if (sd.index < s.totalQ) sessionPromptSimple(s, out);
+    else sessionFinishSimple(s, out);
+}
+
+// Grades a letter answer, updating the streak
+int sessionGradeSimple(QuizSession &s, const Question &q, const string &inp, ostream &out) {
+    if (inp.length() == 0) {
+        out << "No answer entered." << endl;
+        return 4;
+    }
+    char ans = upchar(inp[0]);
+    if (ans == q.correct) {
+        out << "Correct!" << endl;
+        s.sd.streak++;
+        return 1;
+    } else if (ans >= 'A' && ans <= 'D') {
+        out << "Wrong. Correct was " << q.correct << endl;
+        s.sd.streak = 0;
+        return 0;
+    }
+    out << "Invalid input." << endl;
+    return 4;
+}
+
+// Ends the current question as timed out (the deadline passed while
+// waiting for input)
+void sessionTimeoutSimple(QuizSession &s, ostream &out) {
+    if (s.state == SESSION_DONE) return;
+    Question q = sessionQuestionSimple(s);
+    recordAnswerLatency(q, (uint64_t)sessionElapsedMs(s));
+    countQuestionStat(q, QSTAT_TIMEOUT);
+    out << endl << "Time up!" << endl;
+    sessionAdvanceSimple(s, -1, out);
+}
+
+// Feeds one input line to the session. The deadline runs from when the
+// question was shown; 50/50 keeps it and extra time moves it 10 s later.
+void sessionInputSimple(QuizSession &s, const string &inp, ostream &out) {
+    if (s.state == SESSION_DONE) return;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    int64_t used = sessionElapsedMs(s);
+    Question q = sessionQuestionSimple(s);
+    LifeLines &life = s.sd.life;
+    int res;
+
+    if (s.state == SESSION_FOLLOWUP) {
+        recordAnswerLatency(q, (uint64_t)used);
+        if (used > s.limitMs) {
+            out << "Time up!" << endl;
+            res = -1;
+        } else {
+            res = sessionGradeSimple(s, q, inp, out);
         }
-        else if (res == 3) {
-            // replace: send this question to end of play list
-            if (totalQ < MAX_PLAY_QUESTIONS) {
-                pick[totalQ] = pick[i];
-                totalQ++;
-            }
-            // shift left to remove current
-            for (int s = i; s < totalQ - 1; s++) {
-                pick[s] = pick[s + 1];
+    } else {
+        char c = inp.length() > 0 ? inp[0] : 0;
+        if ((c == '1' && !life.used5050) || (c == '4' && !life.usedExtra)) {
+            countQuestionStat(q, c == '1' ? QSTAT_5050 : QSTAT_EXTRA);
+            if (c == '1') {
+                life.used5050 = true;
+                out << "50/50 used. Showing correct option and one wrong option:" << endl;
+                string_view opts[4] = { q.A, q.B, q.C, q.D };
+                if (q.correct >= 'A' && q.correct <= 'D') out << q.correct << ") " << opts[q.correct - 'A'] << endl;
+                char wrongOpt = q.correct == 'A' ? 'B' : 'A';
+                out << wrongOpt << ") " << opts[wrongOpt - 'A'] << endl;
+                out << "Enter answer (A-D): ";
+                s.sd.hidden = 15 & ~(1 << (wrongOpt - 'A'));
+                if (q.correct >= 'A' && q.correct <= 'D') s.sd.hidden &= ~(1 << (q.correct - 'A'));
+            } else {
+                life.usedExtra = true;
+                s.sd.extraMs = 10000; // grant +10 seconds
+                s.limitMs += s.sd.extraMs;
+                out << "Extra time granted. Enter answer: ";
             }
-            // do not increment i (new question now at i)
+            s.state = SESSION_FOLLOWUP;
+            s.sd.followUp = true;
+            countStatSimple(COUNT_LIFELINES);
+            sessionTimeSimple(s, PHASE_ASK, t0);
+            sessionSaveSimple(s);
+            return;
         }
-        else {
-            // invalid / no answer: move on without penalty
-            i++;
+        if (c == '2' && !life.usedSkip) {
+            life.usedSkip = true;
+            out << "Skipped." << endl;
+            countStatSimple(COUNT_LIFELINES);
+            res = 2;
+        } else if (c == '3' && !life.usedReplace) {
+            life.usedReplace = true;
+            out << "Replace used. This question will appear later." << endl;
+            countStatSimple(COUNT_LIFELINES);
+            res = 3;
+        } else if (used > s.limitMs) {
+            recordAnswerLatency(q, (uint64_t)used);
+            out << "Time up!" << endl;
+            res = -1;
+        } else {
+            recordAnswerLatency(q, (uint64_t)used);
+            res = sessionGradeSimple(s, q, inp, out);
         }
+    }
+
+    // outcome of this question for its statistics
+    if (res == 1) countQuestionStat(q, QSTAT_CORRECT, (uint64_t)used);
+    else if (res == 0) countQuestionStat(q, QSTAT_WRONG, (uint64_t)used);
+    else if (res == -1) countQuestionStat(q, QSTAT_TIMEOUT);
+    else if (res == 2) countQuestionStat(q, QSTAT_SKIP);
+    else if (res == 3) countQuestionStat(q, QSTAT_REPLACE);
+    else countQuestionStat(q, QSTAT_NO_ANSWER);
+
+    sessionTimeSimple(s, PHASE_ASK, t0);
+    sessionAdvanceSimple(s, res, out);
+}
+
+// ---------- ANSWER FEEDS ----------
+
+// Where answers come from: the console, a fixed script of inputs, or a
+// seeded random player. Script and random feeds let whole sessions run
+// without a terminal (see HEADLESS MODE).
+enum FeedMode { FEED_CONSOLE, FEED_SCRIPT, FEED_RANDOM };
+
+// What nextAnswerSimple got
+enum FeedResult { FEED_LINE, FEED_TIMEOUT, FEED_EOF };
+
+struct AnswerFeed {
+    FeedMode mode;
+    vector<string> script;  // FEED_SCRIPT: inputs, reused from the start when exhausted
+    size_t pos;
+    QuizRng rng;            // FEED_RANDOM
+    int correctPct;         // FEED_RANDOM: chance of answering correctly
+    int lifelinePct;        // FEED_RANDOM: chance of trying a lifeline first
+};
+
+// Returns a feed that reads answers from the console
+AnswerFeed consoleFeedSimple() {
+    AnswerFeed f;
+    f.mode = FEED_CONSOLE;
+    f.pos = 0;
+    f.rng = makeRngSimple(0);
+    f.correctPct = 0;
+    f.lifelinePct = 0;
+    return f;
+}
+
+// Waits up to ms for a line on an interactive stdin; false on timeout.
+// Anything typed but not yet entered is discarded on timeout so it is
+// not taken as the answer to the next question.
+bool waitForInputSimple(int64_t ms) {
+    chrono::steady_clock::time_point until = chrono::steady_clock::now() + chrono::milliseconds(ms);
+    while (true) {
+        int64_t left = chrono::duration_cast<chrono::milliseconds>(until - chrono::steady_clock::now()).count();
+        if (left < 0) left = 0;
+        pollfd pfd;
+        pfd.fd = STDIN_FILENO;
+        pfd.events = POLLIN;
+        int n = poll(&pfd, 1, (int)left);
+        if (n > 0) return true;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return true; // cannot wait: fall back to a plain read
+        tcflush(STDIN_FILENO, TCIFLUSH);
+        return false;
+    }
+}
+
+// Produces the next input line for the session's current prompt. Only
+// the console enforces the deadline while waiting; input piped in from a
+// file or script is read as it comes.
+FeedResult nextAnswerSimple(AnswerFeed &feed, const QuizSession &s, string &inp) {
+    if (feed.mode == FEED_CONSOLE) {
+        if (isatty(STDIN_FILENO) && !waitForInputSimple(sessionRemainingMs(s))) return FEED_TIMEOUT;
+        if (getline(cin, inp)) return FEED_LINE;
+        inp = "";
+        return FEED_EOF;
+    }
+    if (feed.mode == FEED_SCRIPT) {
+        if (feed.script.empty()) { inp = ""; return FEED_EOF; }
+        if (feed.pos >= feed.script.size()) feed.pos = 0;
+        inp = feed.script[feed.pos++];
+        return FEED_LINE;
+    }
 
-        // save progress after each question
-        sd.index = i;
-        sd.score = score;
-        sd.correctCount = correct;
-        sd.wrongCount = wrong;
-        sd.life = life;
-        saveGameSimple(sd);
+    // FEED_RANDOM: maybe a lifeline that is still available, else a letter
+    const LifeLines &life = s.sd.life;
+    if (s.state == SESSION_ANSWER && (int)randBelowSimple(feed.rng, 100) < feed.lifelinePct) {
+        char avail[4];
+        int n = 0;
+        if (!life.used5050) avail[n++] = '1';
+        if (!life.usedSkip) avail[n++] = '2';
+        if (!life.usedReplace) avail[n++] = '3';
+        if (!life.usedExtra) avail[n++] = '4';
+        if (n > 0) { inp.assign(1, avail[randBelowSimple(feed.rng, (uint32_t)n)]); return FEED_LINE; }
     }
+    char correct = s.queue.size > 0 ? sessionQuestionSimple(s).correct : 'A';
+    if ((int)randBelowSimple(feed.rng, 100) < feed.correctPct) {
+        inp.assign(1, correct);
+    } else {
+        char wrong = (char)('A' + randBelowSimple(feed.rng, 3));
+        if (wrong >= correct) wrong++;
+        inp.assign(1, wrong);
+    }
+    return FEED_LINE;
+}
+
+// Runs a session to the end with answers from feed
+void driveSessionSimple(QuizSession &s, AnswerFeed &feed, ostream &out) {
+    string inp;
+    while (s.state != SESSION_DONE) {
+        FeedResult got;
+        {
+            ScopedStat timer(STAT_INPUT_WAIT);
+            got = nextAnswerSimple(feed, s, inp);
+        }
+        if (got == FEED_TIMEOUT) sessionTimeoutSimple(s, out);
+        else sessionInputSimple(s, inp, out);
+    }
+}
 
-    // finalization: report results, save high score, log, and clear save
-    cout << endl << "Final Score: " << score << endl;
-    cout << "Correct: " << correct << "  Wrong: " << wrong << endl;
+// ---------- START A NEW QUIZ SESSION ----------
 
-    saveHighScore(player, score);
-    logQuizRun(player, cat, diff, score, correct, wrong);
-    clearSaveSimple();
+// Plays a full new session with answers from feed and all text going to
+// out; timings, when given, receives the phase times. Returns false when
+// the category has nothing to play.
+bool runSessionSimple(const string &player, const string &cat, char diff, uint64_t seedVal,
+                      AnswerFeed &feed, ostream &out, SessionTimings *timings) {
+    QuizSession s;
+    s.timings = timings;
+    if (timings) {
+        for (int p = 0; p < PHASE_COUNT; p++) timings->us[p] = 0;
+        timings->questions = 0;
+    }
+    if (!sessionStartSimple(s, player, cat, diff, seedVal, out)) return false;
+    driveSessionSimple(s, feed, out);
+    return true;
+}
 
-    cout << "Quiz completed." << endl;
+// Starts an interactive session on the console
+void startQuizSimple(const string &player, const string &cat, char diff) {
+    AnswerFeed feed = consoleFeedSimple();
+    runSessionSimple(player, cat, diff, (uint64_t)time(NULL), feed, cout, NULL);
 }
 
 // ---------- RESUME SAVED QUIZ ----------
 
-// Loads save file, reconstructs shuffle using stored seed, and continues
+// Asks for the player, finds their saved session(s) and continues the
+// chosen one from its saved state
 void resumeQuizSimple() {
+    cout << "Enter your name: ";
+    string name;
+    getline(cin, name);
+
+    vector<SaveData> found;
     SaveData sd;
-    if (!loadGameSimple(sd)) {
+    listSavesSimple(name, found);
+    int foundCount = (int)found.size();
+    if (foundCount == 0) {
         cout << "No saved quiz." << endl;
         return;
     }
-    cout << "Resuming quiz for " << sd.playerName << " in " << sd.categoryName << " difficulty " << sd.diff << endl;
 
-    // load category questions
-    Question pool[MAX_QUESTIONS];
-    int total = loadQuestionsFromFile(sd.categoryName, pool, MAX_QUESTIONS);
-
-    // filter by difficulty into pick[]
-    Question pick[MAX_PLAY_QUESTIONS];
-    int pickCount = 0;
-    for (int i = 0; i < total; i++) {
-        if (pool[i].diff == sd.diff) {
-            if (pickCount < MAX_PLAY_QUESTIONS) {
-                pick[pickCount] = pool[i];
-                pickCount++;
-            }
+    int pickSave = 0;
+    if (foundCount > 1) {
+        cout << "Saved quizzes:" << endl;
+        for (int i = 0; i < foundCount; i++) {
+            cout << (i + 1) << ") " << found[i].categoryName << " difficulty " << found[i].diff
+                 << " (question " << (found[i].index + 1) << ")" << endl;
         }
+        cout << "Enter choice: ";
+        int x;
+        if (!(cin >> x)) { cin.clear(); cin.ignore(1000, '\n'); return; }
+        cin.ignore(1000, '\n');
+        if (x < 1 || x > foundCount) { cout << "Invalid." << endl; return; }
+        pickSave = x - 1;
     }
-    if (pickCount == 0) {
-        cout << "No questions for this save." << endl;
+    sd = found[pickSave];
+    bool offered = false;
+    for (size_t i = 0; i < catalog.size() && !offered; i++) offered = (catalog[i].name == sd.categoryName);
+    if (!offered) {
+        cout << "The " << sd.categoryName << " category is no longer available; its save is kept." << endl;
         return;
     }
+    cout << "Resuming quiz for " << sd.playerName << " in " << sd.categoryName << " difficulty " << sd.diff << endl;
 
-    // reconstruct shuffle using seed stored in save
-    srand((unsigned int)sd.seedValue);
-    simpleShuffle(pick, pickCount);
-
-    int totalQ = pickCount;
-    if (totalQ > 10) totalQ = 10;
-
-    int score = sd.score;
-    int correct = sd.correctCount;
-    int wrong = sd.wrongCount;
-    int streak = 0;
-    LifeLines life = sd.life;
-
-    int i = sd.index; // resume index
-    while (i < totalQ) {
-        cout << endl << "Question " << (i + 1) << " of " << totalQ << endl;
-        int res = askQuestionSimple(pick[i], life, streak);
-        if (res == 1) {
-            score++; correct++;
-            if (streak == 3) { score += 5; cout << "Streak +5!" << endl; }
-            if (streak == 5) { score += 15; cout << "Streak +15!" << endl; }
-            i++;
-        } else if (res == 0 || res == -1) {
-            score -= getPenaltySimple(sd.diff);
-            wrong++;
-            i++;
-        } else if (res == 2) {
-            i++;
-        } else if (res == 3) {
-            if (totalQ < MAX_PLAY_QUESTIONS) {
-                pick[totalQ] = pick[i];
-                totalQ++;
-            }
-            for (int s = i; s < totalQ - 1; s++) pick[s] = pick[s + 1];
-            // do not increment i
-        } else {
-            i++;
-        }
-
-        // save progress after each question
-        sd.index = i;
-        sd.score = score;
-        sd.correctCount = correct;
-        sd.wrongCount = wrong;
-        sd.life = life;
-        saveGameSimple(sd);
-    }
-
-    cout << "Resumed Quiz Finished. Score: " << score << endl;
-    saveHighScore(sd.playerName, score);
-    logQuizRun(sd.playerName, sd.categoryName, sd.diff, score, correct, wrong);
-    clearSaveSimple();
+    QuizSession s;
+    s.timings = NULL;
+    if (!sessionRestoreSimple(s, sd, cout)) return;
+    AnswerFeed feed = consoleFeedSimple();
+    driveSessionSimple(s, feed, cout);
 }
 
 // ---------- ADD QUESTION INTERFACE ----------
@@ -725,15 +4972,15 @@ void resumeQuizSimple() {
 // Allows user to append a new question to a category file
 void addQuestionSimple() {
     cout << "Select category to add question:" << endl;
-    for (int i = 0; i < MAX_CATEGORIES; i++) {
-        cout << (i + 1) << ") " << categories[i] << endl;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        cout << (i + 1) << ") " << catalog[i].name << endl;
     }
     cout << "Enter choice: ";
     int ch = 0;
     if (!(cin >> ch)) { cin.clear(); cin.ignore(1000, '\n'); cout << "Invalid." << endl; return; }
     cin.ignore(1000, '\n');
-    if (ch < 1 || ch > MAX_CATEGORIES) { cout << "Invalid." << endl; return; }
-    int idx = ch - 1;
+    if (ch < 1 || ch > (int)catalog.size()) { cout << "Invalid." << endl; return; }
+    const string &cat = catalog[ch - 1].name;
 
     cout << "Enter difficulty (E/M/H): ";
     char d;
@@ -752,8 +4999,26 @@ void addQuestionSimple() {
     ans = upchar(ans);
     if (ans < 'A' || ans > 'D') ans = 'A';
 
-    ofstream out((categories[idx] + ".txt").c_str(), ios::app);
-    if (!out) { cout << "Cannot open file to add question." << endl; return; }
+    // one probe in the category's duplicate index
+    Question nq;
+    nq.diff = d;
+    nq.text = simpleTrim(q);
+    nq.A = simpleTrim(A);
+    nq.B = simpleTrim(B);
+    nq.C = simpleTrim(C);
+    nq.D = simpleTrim(D);
+    nq.correct = ans;
+    uint64_t h = contentHashSimple(nq);
+    DedupIndex ix;
+    bool indexed = openDedupIndex(cat, ix);
+    if (indexed && dedupContainsSimple(ix, h)) {
+        closeDedupIndex(ix);
+        cout << "That question is already in " << cat << " (same text and options); not added." << endl;
+        return;
+    }
+
+    ofstream out(categoryFileName(cat).c_str(), ios::app);
+    if (!out) { closeDedupIndex(ix); cout << "Cannot open file to add question." << endl; return; }
     out << "Q: " << q << endl;
     out << "A) " << A << endl;
     out << "B) " << B << endl;
@@ -764,21 +5029,24 @@ void addQuestionSimple() {
     out << "---" << endl;
     out.close();
 
-    cout << "Question added to " << categories[idx] << ".txt" << endl;
+    FileStamp src;
+    if (indexed && statStampSimple(categoryFileName(cat), src)) dedupAddSimple(cat, ix, h, src);
+    closeDedupIndex(ix);
+    cout << "Question added to " << categoryFileName(cat) << endl;
 }
 
 // ---------- PICK CATEGORY / DIFFICULTY HELPERS ----------
 
 int pickCategorySimple() {
     cout << "Categories:" << endl;
-    for (int i = 0; i < MAX_CATEGORIES; i++) {
-        cout << (i + 1) << ") " << categories[i] << endl;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        cout << (i + 1) << ") " << catalog[i].name << endl;
     }
     cout << "Enter choice: ";
     int x;
     if (!(cin >> x)) { cin.clear(); cin.ignore(1000, '\n'); return -1; }
     cin.ignore(1000, '\n');
-    if (x >= 1 && x <= MAX_CATEGORIES) return x - 1;
+    if (x >= 1 && x <= (int)catalog.size()) return x - 1;
     return -1;
 }
 
@@ -796,14 +5064,917 @@ char pickDiffSimple() {
     return 'H';
 }
 
+// Asks for a category and difficulty and shows that leaderboard
+void showCategoryHighScores() {
+    int cat = pickCategorySimple();
+    if (cat < 0) return;
+    char d = pickDiffSimple();
+    vector<ScoreEntry> rows;
+    topScoresFor(boardKeySimple(catalog[cat].name, d), 5, rows);
+    cout << "Top scores in " << catalog[cat].name << "/" << d << ":" << endl;
+    printTopRows(rows);
+}
+
+// Prints the hot-path timers, answer latencies, the hardest questions and
+// the cache and writer counters, and refreshes the stats files
+void showStatsSimple() {
+    printStatsSimple(cout);
+    printLatencySimple(cout, catalogNamesSimple(), 3);
+    printQuestionStatsSimple(cout, catalogNamesSimple(), 3, 10);
+    BankCacheStats bc = getBankCacheStats();
+    cout << "bank cache: " << bc.hits << " hits, " << bc.misses << " misses, " << bc.reloads << " reloads" << endl;
+    AsyncWriterStats ws = getAsyncWriterStats();
+    cout << "writer: " << ws.written << " lines written, " << ws.dropped << " dropped, "
+         << ws.backpressured << " back-pressured, " << ws.direct << " written directly" << endl;
+    if (statsEnabled && writeStatsFileSimple(statsFile) && saveQuestionStats(questionStatsFile)) {
+        cout << "Written to " << statsFile << " and " << questionStatsFile << endl;
+    }
+}
+
+// ---------- SCANNER CHECK ----------
+
+// Fragments the fuzzer builds lines from: every line prefix of the format,
+// near misses of each, whitespace isspace() accepts, and non-ASCII bytes
+const char *const scanFuzzPieces[] = {
+    "Q:", "Q: ", "q:", "Q", "A)", "B)", "C)", "D)", "E)", "A) ", "a)", "ANSWER:", "ANSWER: ",
+    "ANSWER", "answer:", "DIFF:", "DIFF: ", "DIFF", "diff:", "---", "--", "----", "-",
+    " ", "  ", "\t", "\r", "\v", "\f", ":", ")", "A", "B", "D", "E", "M", "H", "x",
+    "Paris", "42", "None of the above", "\xC3\xA9", "\xA0", "\x85", "\xFF"
+};
+
+// Builds a random question file: mostly lines that start with a format
+// prefix, padded with whitespace and noise, sometimes without a final
+// newline
+string fuzzQuestionTextSimple(QuizRng &rng) {
+    const uint32_t pieceCount = (uint32_t)(sizeof(scanFuzzPieces) / sizeof(scanFuzzPieces[0]));
+    const char *const prefixes[] = { "Q: ", "A) ", "B) ", "C) ", "D) ", "ANSWER: ", "DIFF: ", "---" };
+    const char *const spaces[] = { " ", "  ", "\t", "\r", "\v", "\f" };
+    string text;
+    uint32_t lines = randBelowSimple(rng, 80);
+    for (uint32_t i = 0; i < lines; i++) {
+        if (randBelowSimple(rng, 4) == 0) text += spaces[randBelowSimple(rng, 6)];
+        if (randBelowSimple(rng, 3) != 0) text += prefixes[randBelowSimple(rng, 8)];
+        uint32_t words = randBelowSimple(rng, 4);
+        for (uint32_t w = 0; w < words; w++) text += scanFuzzPieces[randBelowSimple(rng, pieceCount)];
+        if (i + 1 < lines || randBelowSimple(rng, 2) == 0) text += '\n';
+    }
+    return text;
+}
+
+// True if the line parser and the bulk scanner read the same questions,
+// with the same fields at the same offsets, from 'text'
+bool checkScanSimple(const string &text) {
+    QuestionBank a, b;
+    a.arena = text;
+    b.arena = text;
+    int na = parseQuestionLines(a);
+    int nb = scanQuestionsText(b);
+    if (na != nb || a.ownDiff != b.ownDiff || a.ownCorrect != b.ownCorrect || a.ownText != b.ownText) return false;
+    const vector<string_view> &sa = a.ownStrings.strings;
+    const vector<string_view> &sb = b.ownStrings.strings;
+    if (sa.size() != sb.size()) return false;
+    for (size_t i = 0; i < sa.size(); i++) {
+        if (sa[i].size() != sb[i].size() || sa[i].data() - a.arena.data() != sb[i].data() - b.arena.data()) return false;
+    }
+    return true;
+}
+
+// "quiz --check-scanner [fuzz=N] [seed=S]": checks the bulk scanner
+// against the line parser on every category file and on N fuzzed inputs
+int runScannerCheckSimple(int argc, char *argv[], int first) {
+    long fuzz = 10000;
+    uint64_t seed = (uint64_t)time(NULL);
+    for (int i = first; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 5, "fuzz=") == 0) fuzz = atol(arg.c_str() + 5);
+        else if (arg.compare(0, 5, "seed=") == 0) seed = strtoull(arg.c_str() + 5, NULL, 10);
+        else { cout << "Unknown option: " << arg << endl; return 1; }
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        string text;
+        if (!readWholeFile(categoryFileName(catalog[i].name), text)) continue;
+        if (!checkScanSimple(text)) { cout << "Mismatch in " << categoryFileName(catalog[i].name) << endl; failed++; }
+    }
+
+    QuizRng rng = makeRngSimple(seed);
+    for (long n = 0; n < fuzz; n++) {
+        string text = fuzzQuestionTextSimple(rng);
+        if (!checkScanSimple(text)) {
+            if (failed < 5) cout << "Mismatch on fuzzed input " << n << " (seed=" << seed << ")" << endl;
+            failed++;
+        }
+    }
+    cout << "Scanner check: " << catalog.size() << " category files, " << fuzz << " fuzzed inputs, "
+         << failed << " mismatches" << endl;
+    return failed == 0 ? 0 : 1;
+}
+
+// ---------- HEADLESS MODE ----------
+
+// "quiz --headless [key=value ...]" plays many sessions without a terminal
+// and reports throughput and per-phase latency. Each worker thread gets its
+// own score, log and save files under <dir>/t<n>/ together with its own save
+// store and leaderboard, so workers never touch the player's files or each
+// other's; only the question bank cache is shared.
+struct HeadlessConfig {
+    int sessions;           // total sessions across all threads
+    int threads;
+    FeedMode mode;          // FEED_RANDOM or FEED_SCRIPT
+    vector<string> script;  // inputs for FEED_SCRIPT
+    string category;        // a category name, or "all" to rotate
+    char diff;              // E/M/H, or 0 to rotate
+    string dir;             // root of the per-thread output directories
+    uint64_t seed;
+    int correctPct;
+    int lifelinePct;
+};
+
+// Stream buffer that discards everything written to it
+struct NullBufSimple : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// Creates a directory; an existing one is fine
+bool makeDirSimple(const string &path) {
+    if (mkdir(path.c_str(), 0755) == 0) return true;
+    return errno == EEXIST;
+}
+
+// Reads key=value arguments starting at argv[first]; false on a bad one
+bool parseHeadlessArgs(int argc, char *argv[], int first, HeadlessConfig &cfg) {
+    cfg.sessions = 1000;
+    cfg.threads = (int)thread::hardware_concurrency();
+    if (cfg.threads < 1) cfg.threads = 1;
+    cfg.mode = FEED_RANDOM;
+    cfg.category = "all";
+    cfg.diff = 0;
+    cfg.dir = "headless_out";
+    cfg.seed = (uint64_t)time(NULL);
+    cfg.correctPct = 60;
+    cfg.lifelinePct = 10;
+
+    for (int i = first; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == string::npos) { cout << "Expected key=value: " << arg << endl; return false; }
+        string key = arg.substr(0, eq);
+        string val = arg.substr(eq + 1);
+        if (key == "sessions") cfg.sessions = atoi(val.c_str());
+        else if (key == "threads") cfg.threads = atoi(val.c_str());
+        else if (key == "strategy" && val == "random") cfg.mode = FEED_RANDOM;
+        else if (key == "strategy" && val == "script") cfg.mode = FEED_SCRIPT;
+        else if (key == "script") { cfg.mode = FEED_SCRIPT; cfg.script = splitListSimple(val, ','); }
+        else if (key == "category") cfg.category = val;
+        else if (key == "diff" && val == "all") cfg.diff = 0;
+        else if (key == "diff" && val.size() == 1 && diffSlot(upchar(val[0])) >= 0) cfg.diff = upchar(val[0]);
+        else if (key == "dir") cfg.dir = val;
+        else if (key == "seed") cfg.seed = strtoull(val.c_str(), NULL, 10);
+        else if (key == "correct") cfg.correctPct = atoi(val.c_str());
+        else if (key == "lifelines") cfg.lifelinePct = atoi(val.c_str());
+        else if (key == "fsync") journalSyncEvery = atoi(val.c_str());
+        else if (key == "length") playLength = atoi(val.c_str());
+        else { cout << "Unknown option: " << arg << endl; return false; }
+    }
+    if (cfg.sessions < 1 || cfg.threads < 1) { cout << "sessions and threads must be positive." << endl; return false; }
+    if (playLength < 1) { cout << "length must be positive." << endl; return false; }
+    if (cfg.mode == FEED_SCRIPT && cfg.script.empty()) { cout << "strategy=script needs script=A,B,..." << endl; return false; }
+    return true;
+}
+
+// Work and results of one headless thread
+struct HeadlessWorker {
+    int id;
+    int sessions;
+    vector<SessionTimings> timings;
+    int failed;
+};
+
+// Runs one thread's share of sessions against its own files and state
+void headlessWorkerSimple(const HeadlessConfig &cfg, HeadlessWorker &w) {
+    string dir = cfg.dir + "/t" + to_string(w.id);
+    makeDirSimple(dir);
+    QuizPaths paths;
+    paths.highScores = dir + "/" + defaultPaths.highScores;
+    paths.topScores = dir + "/" + defaultPaths.topScores;
+    paths.logs = dir + "/" + defaultPaths.logs;
+    paths.saveStore = dir + "/" + defaultPaths.saveStore;
+    paths.journal = dir + "/" + defaultPaths.journal;
+    paths.legacySave = dir + "/" + defaultPaths.legacySave;
+    SaveStore store;
+    Leaderboard board;
+    activePaths = &paths;
+    activeStore = &store;
+    activeBoard = &board;
+
+    NullBufSimple nullBuf;
+    ostream out(&nullBuf);
+
+    // every thread draws from its own stream so runs are reproducible
+    QuizRng seeds = makeRngSimple(cfg.seed + (uint64_t)w.id * 0x9E3779B97F4A7C15ULL);
+    AnswerFeed feed;
+    feed.mode = cfg.mode;
+    feed.script = cfg.script;
+    feed.pos = 0;
+    feed.rng = makeRngSimple(nextRandSimple(seeds));
+    feed.correctPct = cfg.correctPct;
+    feed.lifelinePct = cfg.lifelinePct;
+
+    const char diffs[3] = { 'E', 'M', 'H' };
+    w.timings.reserve(w.sessions);
+    w.failed = 0;
+    for (int n = 0; n < w.sessions; n++) {
+        string cat = cfg.category == "all" ? catalog[(w.id + n) % catalog.size()].name : cfg.category;
+        char diff = cfg.diff ? cfg.diff : diffs[n % 3];
+        string player = "bot" + to_string(w.id) + "_" + to_string(n);
+        SessionTimings tm;
+        if (runSessionSimple(player, cat, diff, nextRandSimple(seeds), feed, out, &tm)) w.timings.push_back(tm);
+        else w.failed++;
+    }
+
+    closeSaveStore();
+    closeLeaderboard();
+    activePaths = &defaultPaths;
+    activeStore = &defaultStore;
+    activeBoard = &defaultBoard;
+}
+
+// Value at fraction p of a sorted sample (nearest rank)
+double percentileSimple(const vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)(p * sorted.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+// Runs the configured load and prints the report; returns the exit code
+int runHeadlessSimple(const HeadlessConfig &cfg) {
+    if (!makeDirSimple(cfg.dir)) { cout << "Cannot create " << cfg.dir << endl; return 1; }
+    if (cfg.category == "all" && catalog.empty()) { cout << "No categories in " << questionDir << endl; return 1; }
+
+    vector<HeadlessWorker> workers(cfg.threads);
+    for (int t = 0; t < cfg.threads; t++) {
+        workers[t].id = t;
+        workers[t].sessions = cfg.sessions / cfg.threads + (t < cfg.sessions % cfg.threads ? 1 : 0);
+    }
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int t = 0; t < cfg.threads; t++) {
+        pool.push_back(thread(headlessWorkerSimple, cref(cfg), ref(workers[t])));
+    }
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+    double wallUs = elapsedUsSimple(t0);
+
+    // merge per-session timings into one sample per phase
+    vector<double> phase[PHASE_COUNT + 1]; // last one is the whole session
+    long long questions = 0;
+    int failed = 0;
+    for (size_t t = 0; t < workers.size(); t++) {
+        failed += workers[t].failed;
+        for (size_t k = 0; k < workers[t].timings.size(); k++) {
+            const SessionTimings &tm = workers[t].timings[k];
+            double total = 0;
+            for (int p = 0; p < PHASE_COUNT; p++) { phase[p].push_back(tm.us[p]); total += tm.us[p]; }
+            phase[PHASE_COUNT].push_back(total);
+            questions += tm.questions;
+        }
+    }
+    size_t done = phase[PHASE_COUNT].size();
+
+    printf("Headless run: %zu sessions (%d failed) on %d threads, %lld questions\n",
+           done, failed, cfg.threads, questions);
+    printf("Wall time: %.3f s, %.1f sessions/sec\n", wallUs / 1e6, done / (wallUs / 1e6));
+    printf("%-8s %10s %10s %10s %10s   (microseconds)\n", "phase", "p50", "p90", "p99", "max");
+    for (int p = 0; p <= PHASE_COUNT; p++) {
+        sort(phase[p].begin(), phase[p].end());
+        printf("%-8s %10.1f %10.1f %10.1f %10.1f\n", p < PHASE_COUNT ? phaseNames[p] : "session",
+               percentileSimple(phase[p], 0.50), percentileSimple(phase[p], 0.90),
+               percentileSimple(phase[p], 0.99), phase[p].empty() ? 0.0 : phase[p].back());
+    }
+
+    stopAsyncWriter();
+    AsyncWriterStats ws = getAsyncWriterStats();
+    printf("Writer: %llu lines written, %llu dropped, %llu back-pressured, %llu written directly\n",
+           ws.written, ws.dropped, ws.backpressured, ws.direct);
+    if (statsEnabled) {
+        printStatsSimple(cout);
+        writeStatsFileSimple(statsFile);
+    }
+    printf("Output: %s/t0..t%d\n", cfg.dir.c_str(), cfg.threads - 1);
+    return failed == 0 ? 0 : 1;
+}
+
+// ---------- QUIZ SERVER ----------
+
+#ifdef __linux__
+// "quiz --serve [port=N | unix=PATH] [length=N]" plays the quiz with many clients on
+// one epoll loop. Each connection walks name -> category -> difficulty and
+// then drives a QuizSession with its input lines. All connections share the
+// question bank cache, the save store and the leaderboard. A player with a
+// suspended session in the chosen category is offered to resume it, here
+// or from a console (the store is shared between processes); a player may
+// only play a category on one connection at a time, since both would
+// share one save slot. Looking up a save and starting or resuming a
+// session (which may parse, compile or stream a category file) run on
+// serverLoaders loader threads while the loop serves other connections.
+// During play the loop only updates the mapped save slot and queues
+// journal, score and log lines; making them durable, the leaderboard
+// index and the stats file are left to a persistence thread that runs
+// every serverSyncMs (see backgroundPersist).
+const int serverSyncMs = 100;
+const int serverLoaders = 4;
+
+enum ConnStage { CONN_NAME, CONN_CATEGORY, CONN_RESUME, CONN_DIFF, CONN_LOADING, CONN_PLAY, CONN_CLOSING };
+
+// Work a loader thread does for a connection
+enum ServerJobKind { JOB_LOOKUP, JOB_START, JOB_RESUME };
+
+struct ServerConn {
+    int fd;
+    ConnStage stage;
+    string in;              // bytes received but not yet a full line
+    string out;             // bytes still to send
+    size_t outPos;
+    bool peerClosed;
+    bool broken;            // send or socket error while a load was running
+    string player;
+    int cat;
+    string playKey;         // player and category while they hold a save slot
+    QuizSession session;
+    ServerJobKind job;      // load to run while stage is CONN_LOADING
+    char diff;              // difficulty and seed for JOB_START
+    uint64_t seed;
+    string jobOut;          // output of the finished load
+    ConnStage jobStage;     // stage to enter when the load is done
+};
+
+// Loader threads of the server and their queues. A connection is owned
+// by a loader from being queued until the loop takes it from 'done'.
+struct ServerLoader {
+    mutex lock;
+    condition_variable wake;
+    queue<ServerConn *> jobs;
+    vector<ServerConn *> done;
+    int efd;                // eventfd that wakes the loop when 'done' fills
+    bool stop;
+    vector<thread> threads;
+};
+
+// Where the server listens and the client connects
+struct ServerAddr {
+    int port;               // TCP port on 127.0.0.1 when unixPath is empty
+    string unixPath;
+};
+
+volatile sig_atomic_t serverStop = 0;
+
+// SIGINT/SIGTERM handler: lets the loop save state and return
+void onServerSignal(int) { serverStop = 1; }
+
+// Reads port=N / unix=PATH / length=N arguments starting at argv[first]
+bool parseServerArgs(int argc, char *argv[], int first, ServerAddr &addr) {
+    addr.port = 5555;
+    for (int i = first; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 5, "port=") == 0) addr.port = atoi(arg.c_str() + 5);
+        else if (arg.compare(0, 5, "unix=") == 0) addr.unixPath = arg.substr(5);
+        else if (arg.compare(0, 7, "length=") == 0) playLength = atoi(arg.c_str() + 7);
+        else { cout << "Unknown option: " << arg << endl; return false; }
+    }
+    if (playLength < 1) { cout << "length must be positive." << endl; return false; }
+    if (addr.unixPath.empty() && (addr.port <= 0 || addr.port > 65535)) { cout << "Bad port." << endl; return false; }
+    if (addr.unixPath.size() >= sizeof(((sockaddr_un *)0)->sun_path)) { cout << "Socket path too long." << endl; return false; }
+    return true;
+}
+
+// Creates a socket for addr; listening when listen is set, else connected.
+// Returns -1 on failure.
+int openSocketSimple(const ServerAddr &addr, bool listening) {
+    int fd;
+    int rc;
+    if (!addr.unixPath.empty()) {
+        sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, addr.unixPath.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            unlink(addr.unixPath.c_str());
+            rc = bind(fd, (sockaddr *)&sa, sizeof(sa));
+        } else {
+            rc = connect(fd, (sockaddr *)&sa, sizeof(sa));
+        }
+    } else {
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((uint16_t)addr.port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            rc = bind(fd, (sockaddr *)&sa, sizeof(sa));
+        } else {
+            rc = connect(fd, (sockaddr *)&sa, sizeof(sa));
+        }
+    }
+    if (rc == 0 && listening) rc = listen(fd, 128);
+    if (rc != 0) { close(fd); return -1; }
+    return fd;
+}
+
+// Shows the category menu to a connection
+void serverAskCategory(ServerConn &c, ostream &out) {
+    out << "Categories:" << endl;
+    for (size_t i = 0; i < catalog.size(); i++) out << (i + 1) << ") " << catalog[i].name << endl;
+    out << "Enter choice: ";
+    c.stage = CONN_CATEGORY;
+}
+
+// Prints the difficulty menu; returns the stage that reads the answer
+ConnStage serverAskDiff(ostream &out) {
+    out << "Difficulty:" << endl << "1) Easy" << endl << "2) Medium" << endl << "3) Hard" << endl << "Enter: ";
+    return CONN_DIFF;
+}
+
+// Hands a connection to the loader threads
+void serverQueueJob(ServerLoader &ld, ServerConn &c, ServerJobKind job) {
+    c.job = job;
+    c.stage = CONN_LOADING;
+    lock_guard<mutex> guard(ld.lock);
+    ld.jobs.push(&c);
+    ld.wake.notify_one();
+}
+
+// Runs a connection's load on a loader thread. Output and the next stage
+// are left in jobOut and jobStage for the loop to pick up.
+void serverJobSimple(ServerConn &c) {
+    ostringstream out;
+    const string &cat = catalog[c.cat].name;
+    SaveData sd;
+    if (c.job == JOB_LOOKUP) {
+        if (loadGameSimple(c.player, cat, sd)) {
+            out << "You have a saved quiz in " << cat << " difficulty " << sd.diff << " (question "
+                << (sd.index + 1) << "). Resume it? (y/n): ";
+            c.jobStage = CONN_RESUME;
+        } else {
+            c.jobStage = serverAskDiff(out);
+        }
+    } else {
+        bool ok;
+        if (c.job == JOB_RESUME) {
+            ok = loadGameSimple(c.player, cat, sd);
+            if (!ok) out << "No saved quiz." << endl;
+            else out << "Resuming quiz for " << sd.playerName << " in " << cat << " difficulty " << sd.diff << endl;
+            ok = ok && sessionRestoreSimple(c.session, sd, out);
+        } else {
+            ok = sessionStartSimple(c.session, c.player, cat, c.diff, c.seed, out);
+        }
+        c.jobStage = ok && c.session.state != SESSION_DONE ? CONN_PLAY : CONN_CLOSING;
+    }
+    c.jobOut = out.str();
+}
+
+// Loader thread: runs queued loads and signals the loop for each
+void serverLoaderLoop(ServerLoader &ld) {
+    while (true) {
+        ServerConn *c;
+        {
+            unique_lock<mutex> lk(ld.lock);
+            while (!ld.stop && ld.jobs.empty()) ld.wake.wait(lk);
+            if (ld.stop) return;
+            c = ld.jobs.front();
+            ld.jobs.pop();
+        }
+        serverJobSimple(*c);
+        {
+            lock_guard<mutex> guard(ld.lock);
+            ld.done.push_back(c);
+        }
+        eventfd_write(ld.efd, 1);
+    }
+}
+
+// Handles one complete input line for a connection; 'playing' holds the
+// play keys of every connection
+void serverLineSimple(ServerConn &c, const string &line, ostream &out, set<string> &playing, ServerLoader &ld) {
+    if (c.stage == CONN_NAME) {
+        c.player = string(simpleTrim(line));
+        if (c.player.empty()) { out << "Enter your name: "; return; }
+        serverAskCategory(c, out);
+    } else if (c.stage == CONN_CATEGORY) {
+        int x = atoi(line.c_str());
+        if (x < 1 || x > (int)catalog.size()) { out << "Invalid." << endl; serverAskCategory(c, out); return; }
+        string key = c.player + "\n" + catalog[x - 1].name;
+        if (!playing.insert(key).second) {
+            out << c.player << " is already playing " << catalog[x - 1].name << " on another connection." << endl;
+            serverAskCategory(c, out);
+            return;
+        }
+        c.playKey = key;
+        c.cat = x - 1;
+        serverQueueJob(ld, c, JOB_LOOKUP);
+    } else if (c.stage == CONN_RESUME) {
+        // declining starts a new session, which replaces the saved one
+        string_view a = simpleTrim(line);
+        if (!a.empty() && upchar(a[0]) == 'Y') serverQueueJob(ld, c, JOB_RESUME);
+        else c.stage = serverAskDiff(out);
+    } else if (c.stage == CONN_DIFF) {
+        // same mapping as pickDiffSimple: anything but 1 or 2 is Hard
+        int d = atoi(line.c_str());
+        c.diff = d == 1 ? 'E' : (d == 2 ? 'M' : 'H');
+        c.seed = (uint64_t)time(NULL) ^ ((uint64_t)c.fd << 32);
+        serverQueueJob(ld, c, JOB_START);
+    } else if (c.stage == CONN_PLAY) {
+        sessionInputSimple(c.session, line, out);
+        if (c.session.state == SESSION_DONE) c.stage = CONN_CLOSING;
+    }
+}
+
+// Sends as much pending output as the socket takes; false on a dead peer
+bool serverFlushSimple(ServerConn &c) {
+    while (c.outPos < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+        if (n > 0) { c.outPos += (size_t)n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    c.out.clear();
+    c.outPos = 0;
+    return true;
+}
+
+// Sends what a connection has pending and reports whether it should be
+// closed (peer gone, or its session over and all output sent)
+bool serverSettleSimple(ServerConn &c, bool dead) {
+    if (!dead && !serverFlushSimple(c)) dead = true;
+    return dead || (c.out.empty() && (c.stage == CONN_CLOSING || c.peerClosed));
+}
+
+// Min-heap of (question deadline, fd)
+typedef priority_queue<pair<int64_t, int>, vector<pair<int64_t, int> >, greater<pair<int64_t, int> > > DeadlineHeap;
+
+// Runs the complete lines a connection has buffered (none while a load is
+// running for it), queues its next deadline and sends what it can.
+// Returns true when the connection should be closed; one with a load
+// running is kept until the load is done.
+bool serverPumpSimple(ServerConn &c, bool dead, set<string> &playing, ServerLoader &ld, DeadlineHeap &deadlines) {
+    ostringstream out;
+    size_t start = 0;
+    size_t nl;
+    while (c.stage != CONN_CLOSING && c.stage != CONN_LOADING && (nl = c.in.find('\n', start)) != string::npos) {
+        size_t end = nl;
+        if (end > start && c.in[end - 1] == '\r') end--;
+        serverLineSimple(c, c.in.substr(start, end - start), out, playing, ld);
+        start = nl + 1;
+    }
+    c.in.erase(0, start);
+    if (c.peerClosed && !c.in.empty() && c.stage != CONN_CLOSING && c.stage != CONN_LOADING) {
+        serverLineSimple(c, c.in, out, playing, ld); // last line had no newline
+        c.in.clear();
+    }
+    c.out += out.str();
+    if (c.stage == CONN_PLAY && c.session.state != SESSION_DONE) {
+        deadlines.push(make_pair(sessionDeadlineMs(c.session), c.fd));
+    }
+    if (c.stage == CONN_LOADING) {
+        if (dead || !serverFlushSimple(c)) c.broken = true;
+        return false;
+    }
+    return serverSettleSimple(c, dead);
+}
+
+// Removes a connection from the loop and closes it
+void serverCloseSimple(int ep, unordered_map<int, unique_ptr<ServerConn> > &conns, set<string> &playing, int fd) {
+    epoll_ctl(ep, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    unordered_map<int, unique_ptr<ServerConn> >::iterator it = conns.find(fd);
+    if (it != conns.end() && !it->second->playKey.empty()) playing.erase(it->second->playKey);
+    conns.erase(fd);
+}
+
+// Persistence thread of the server: every serverSyncMs makes saves
+// durable, folds the leaderboard and refreshes the stats file
+void serverSyncLoop(atomic<bool> &stop) {
+    while (!stop.load()) {
+        this_thread::sleep_for(chrono::milliseconds(serverSyncMs));
+        syncSaveStoreSimple();
+        refreshLeaderboardSimple();
+        maybeWriteStatsFile(true);
+    }
+}
+
+// Monotonic clock in ms (same base as sessionDeadlineMs)
+int64_t steadyMsSimple() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs the server until SIGINT/SIGTERM; returns the exit code. Question
+// deadlines sit in a min-heap of (deadline, fd); the loop sleeps until
+// the earliest one and times those sessions out. Entries made stale by an
+// answer or extra time are skipped when they come up.
+int runServerSimple(const ServerAddr &addr) {
+    int lfd = openSocketSimple(addr, true);
+    if (lfd < 0) { cout << "Cannot listen: " << strerror(errno) << endl; return 1; }
+    fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) | O_NONBLOCK);
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; // NULL marks the listening socket
+    epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+
+    signal(SIGINT, onServerSignal);
+    signal(SIGTERM, onServerSignal);
+    // open the store and fold the leaderboard here, then hand the disk
+    // to the persistence thread
+    bool storeOpen;
+    {
+        StoreOp op;
+        storeOpen = op.ok;
+    }
+    if (!storeOpen) {
+        cout << "Cannot open " << quizPaths().saveStore << endl;
+        close(ep);
+        close(lfd);
+        if (!addr.unixPath.empty()) unlink(addr.unixPath.c_str());
+        return 1;
+    }
+    if (addr.unixPath.empty()) cout << "Serving on 127.0.0.1:" << addr.port << endl;
+    else cout << "Serving on " << addr.unixPath << endl;
+    refreshLeaderboardSimple();
+    int syncEvery = journalSyncEvery;
+    backgroundPersist = true;
+    journalSyncEvery = 0;
+    atomic<bool> syncStop(false);
+    thread syncer(serverSyncLoop, ref(syncStop));
+
+    ServerLoader loader;
+    loader.stop = false;
+    loader.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &loader; // marks finished loads
+    epoll_ctl(ep, EPOLL_CTL_ADD, loader.efd, &ev);
+    for (int i = 0; i < serverLoaders; i++) loader.threads.push_back(thread(serverLoaderLoop, ref(loader)));
+
+    unordered_map<int, unique_ptr<ServerConn> > conns;
+    set<string> playing;
+    DeadlineHeap deadlines;
+    unsigned long long served = 0;
+    epoll_event events[64];
+    char buf[4096];
+    while (!serverStop) {
+        int wait = 500;
+        if (!deadlines.empty()) {
+            int64_t d = deadlines.top().first - steadyMsSimple();
+            if (d < wait) wait = d < 0 ? 0 : (int)d;
+        }
+        int n = epoll_wait(ep, events, 64, wait);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int e = 0; e < n; e++) {
+            if (events[e].data.ptr == NULL) {
+                // accept everything that is waiting
+                while (true) {
+                    int cfd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (cfd < 0) break;
+                    unique_ptr<ServerConn> c(new ServerConn());
+                    c->fd = cfd;
+                    c->stage = CONN_NAME;
+                    c->outPos = 0;
+                    c->peerClosed = false;
+                    c->broken = false;
+                    c->cat = 0;
+                    c->session.state = SESSION_DONE;
+                    c->session.timings = NULL;
+                    c->out = "==== QUIZ SERVER ====\nEnter your name: ";
+                    epoll_event cev;
+                    memset(&cev, 0, sizeof(cev));
+                    cev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    cev.data.ptr = c.get();
+                    epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &cev);
+                    conns[cfd] = move(c);
+                    served++;
+                }
+                continue;
+            }
+            if (events[e].data.ptr == &loader) {
+                // loads finished: continue those connections
+                eventfd_t count;
+                eventfd_read(loader.efd, &count);
+                vector<ServerConn *> done;
+                {
+                    lock_guard<mutex> guard(loader.lock);
+                    done.swap(loader.done);
+                }
+                for (size_t i = 0; i < done.size(); i++) {
+                    ServerConn &c = *done[i];
+                    c.stage = c.jobStage;
+                    c.out += c.jobOut;
+                    c.jobOut.clear();
+                    if (serverPumpSimple(c, c.broken, playing, loader, deadlines)) serverCloseSimple(ep, conns, playing, c.fd);
+                }
+                continue;
+            }
+
+            ServerConn &c = *(ServerConn *)events[e].data.ptr;
+            bool dead = (events[e].events & EPOLLERR) != 0;
+
+            // edge-triggered: drain the socket, then run every full line
+            while (!dead && !c.peerClosed) {
+                ssize_t r = recv(c.fd, buf, sizeof(buf), 0);
+                if (r > 0) { c.in.append(buf, (size_t)r); continue; }
+                if (r == 0) { c.peerClosed = true; break; }
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) dead = true;
+                break;
+            }
+            if (serverPumpSimple(c, dead, playing, loader, deadlines)) serverCloseSimple(ep, conns, playing, c.fd);
+        }
+
+        // time out sessions whose question deadline has passed
+        int64_t now = steadyMsSimple();
+        while (!deadlines.empty() && deadlines.top().first <= now) {
+            int fd = deadlines.top().second;
+            deadlines.pop();
+            unordered_map<int, unique_ptr<ServerConn> >::iterator it = conns.find(fd);
+            if (it == conns.end()) continue;
+            ServerConn &c = *it->second;
+            if (c.stage != CONN_PLAY || c.session.state == SESSION_DONE || sessionDeadlineMs(c.session) > now) continue;
+            ostringstream out;
+            sessionTimeoutSimple(c.session, out);
+            if (c.session.state == SESSION_DONE) c.stage = CONN_CLOSING;
+            else deadlines.push(make_pair(sessionDeadlineMs(c.session), c.fd));
+            c.out += out.str();
+            if (serverSettleSimple(c, false)) serverCloseSimple(ep, conns, playing, fd);
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(loader.lock);
+        loader.stop = true;
+        loader.wake.notify_all();
+    }
+    for (size_t i = 0; i < loader.threads.size(); i++) loader.threads[i].join();
+    close(loader.efd);
+    for (unordered_map<int, unique_ptr<ServerConn> >::iterator it = conns.begin(); it != conns.end(); ++it) {
+        close(it->first);
+    }
+    close(ep);
+    close(lfd);
+    if (!addr.unixPath.empty()) unlink(addr.unixPath.c_str());
+    syncStop = true;
+    syncer.join();
+    backgroundPersist = false;
+    journalSyncEvery = syncEvery;
+    syncSaveStoreSimple();
+    refreshLeaderboardSimple();
+    cout << "Server stopped after " << served << " connections." << endl;
+    return 0;
+}
+
+// "quiz --client [port=N | unix=PATH]": a stand-in client that sends stdin
+// lines to the server and prints what comes back, for trying the server
+// from a terminal or a script
+int runClientSimple(const ServerAddr &addr) {
+    int fd = openSocketSimple(addr, false);
+    if (fd < 0) { cout << "Cannot connect: " << strerror(errno) << endl; return 1; }
+    signal(SIGPIPE, SIG_IGN);
+    pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = STDIN_FILENO;
+    fds[1].events = POLLIN;
+    char buf[4096];
+    bool inputOpen = true;
+    while (true) {
+        int n = poll(fds, inputOpen ? 2 : 1, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t r = recv(fd, buf, sizeof(buf), 0);
+            if (r <= 0) break;
+            fwrite(buf, 1, (size_t)r, stdout);
+            fflush(stdout);
+        }
+        if (inputOpen && (fds[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t r = read(STDIN_FILENO, buf, sizeof(buf));
+            if (r <= 0) { shutdown(fd, SHUT_WR); inputOpen = false; }
+            else if (!writeAllSimple(fd, buf, (size_t)r)) break;
+        }
+    }
+    close(fd);
+    return 0;
+}
+#endif
+
 // ---------- MAIN MENU ----------
 
-int main() {
-    // seed random once at program start (not used for per-quiz deterministic seed)
-    srand((unsigned int)time(NULL));
+// bench.cpp includes this file with QUIZ_NO_MAIN defined and has its own main
+#ifndef QUIZ_NO_MAIN
+
+int main(int argc, char *argv[]) {
+    // questions=DIR, prewarm=N and stats=0|1 apply to every mode and are
+    // taken out of the arguments before the mode parses its own
+    const char *envStats = getenv("QUIZ_STATS");
+    if (envStats != NULL) statsEnabled = string(envStats) != "0";
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 10, "questions=") == 0) questionDir = arg.substr(10);
+        else if (arg.compare(0, 8, "prewarm=") == 0) prewarmThreads = atoi(arg.c_str() + 8);
+        else if (arg.compare(0, 6, "stats=") == 0) statsEnabled = arg != "stats=0";
+        else argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    // list the categories (writing samples when there are none); banks
+    // load when first played unless prewarming was asked for
+    loadCatalogSimple();
+    if (prewarmThreads > 0) {
+        double ms = prewarmCatalogSimple(prewarmThreads);
+        cout << "Prewarmed " << catalog.size() << " categories on " << prewarmThreads << " threads in " << ms << " ms" << endl;
+    }
+
+    // "quiz --catalog" lists the categories with their question counts
+    if (argc >= 2 && string(argv[1]) == "--catalog") {
+        printCatalogSimple(cout);
+        saveCatalogSimple();
+        return 0;
+    }
+
+    // "quiz --memory [category...]" reports what string interning saves
+    if (argc >= 2 && string(argv[1]) == "--memory") return runMemoryReportSimple(argc, argv, 2);
+
+    // "quiz --dedup [threads=N] [limit=N]" reports duplicate questions
+    if (argc >= 2 && string(argv[1]) == "--dedup") return runDedupReportSimple(argc, argv, 2);
+
+    // "quiz --import FILE [options]" adds questions from CSV, TSV or JSON lines
+    if (argc >= 2 && string(argv[1]) == "--import") {
+        int rc = runImportSimple(argc, argv, 2);
+        saveCatalogSimple();
+        return rc;
+    }
+
+    // "quiz --compile [category...]" rebuilds binary banks and exits
+    if (argc >= 2 && string(argv[1]) == "--compile") {
+        int failed = 0;
+        if (argc == 2) {
+            for (size_t i = 0; i < catalog.size(); i++) {
+                if (!compileQuestionBank(catalog[i].name)) { cout << "Cannot compile " << catalog[i].name << endl; failed++; }
+            }
+        } else {
+            for (int i = 2; i < argc; i++) {
+                if (!compileQuestionBank(argv[i])) { cout << "Cannot compile " << argv[i] << endl; failed++; }
+            }
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "--check-scanner") return runScannerCheckSimple(argc, argv, 2);
+
+    // "quiz --headless [key=value...]" runs scripted or random sessions
+    if (argc >= 2 && string(argv[1]) == "--headless") {
+        HeadlessConfig cfg;
+        if (!parseHeadlessArgs(argc, argv, 2, cfg)) return 2;
+        statsFile = cfg.dir + "/" + statsFile;
+        questionStatsFile = cfg.dir + "/" + questionStatsFile;
+        if (statsEnabled) loadQuestionStats(questionStatsFile);
+        int rc = runHeadlessSimple(cfg);
+        if (statsEnabled) saveQuestionStats(questionStatsFile);
+        saveCatalogSimple();
+        return rc;
+    }
+
+    // per-question statistics carry over between runs
+    if (statsEnabled) loadQuestionStats(questionStatsFile);
 
-    // ensure sample files exist so menu options work immediately
-    makeSampleFilesIfMissing();
+#ifdef __linux__
+    // "quiz --serve" hosts sessions over a socket; "quiz --client" talks to it
+    if (argc >= 2 && (string(argv[1]) == "--serve" || string(argv[1]) == "--client")) {
+        ServerAddr addr;
+        if (!parseServerArgs(argc, argv, 2, addr)) return 2;
+        if (string(argv[1]) == "--client") return runClientSimple(addr);
+        int rc = runServerSimple(addr);
+        closeSaveStore();
+        stopAsyncWriter();
+        closeLeaderboard();
+        if (statsEnabled) {
+            writeStatsFileSimple(statsFile);
+            saveQuestionStats(questionStatsFile);
+        }
+        saveCatalogSimple();
+        return rc;
+    }
+#endif
 
     while (true) {
         cout << endl;
@@ -813,6 +5984,8 @@ int main() {
         cout << "3) Resume Saved Quiz" << endl;
         cout << "4) Add Question" << endl;
         cout << "5) Exit" << endl;
+        cout << "6) Category High Scores" << endl;
+        cout << "7) Statistics" << endl;
         cout << "Enter choice: ";
         int ch = 0;
         if (!(cin >> ch)) {
@@ -829,7 +6002,7 @@ int main() {
             int cat = pickCategorySimple();
             if (cat < 0) continue;
             char d = pickDiffSimple();
-            startQuizSimple(name, categories[cat], d);
+            startQuizSimple(name, catalog[cat].name, d);
         }
         else if (ch == 2) {
             showHighScoresSimple();
@@ -844,15 +6017,25 @@ int main() {
             cout << "Goodbye!" << endl;
             break;
         }
+        else if (ch == 6) {
+            showCategoryHighScores();
+        }
+        else if (ch == 7) {
+            showStatsSimple();
+        }
         else {
             cout << "Invalid option." << endl;
         }
     }
 
+    closeSaveStore();
+    stopAsyncWriter();
+    closeLeaderboard();
+    if (statsEnabled) {
+        writeStatsFileSimple(statsFile);
+        saveQuestionStats(questionStatsFile);
+    }
+    saveCatalogSimple();
     return 0;
 }
-
-
-
-
-
+#endif